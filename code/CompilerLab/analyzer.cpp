@@ -46,6 +46,26 @@ const FuncEntry& Analyzer::FindFunc(string_view identifier) {
 	throw compile_error("function undefined");
 }
 
+bool Analyzer::IsConstExp(const ExpTree& exp_tree) {
+	assert(exp_tree != nullptr);
+	switch (exp_tree->GetType()) {
+	case ExpNodeType::Var: {
+			auto& exp_node_var = exp_tree->As<ExpNode_Var>();
+			if (!FindVar(exp_node_var.identifier).IsConst()) { return false; }
+			for (auto& subscript : exp_node_var.array_subscript) { if (!IsConstExp(subscript)) { return false; } }
+			return true;
+		}
+	case ExpNodeType::FuncCall: return false;
+	case ExpNodeType::Integer: return true;
+	case ExpNodeType::UnaryOp: return IsConstExp(exp_tree->As<ExpNode_UnaryOp>().child);
+	case ExpNodeType::BinaryOp: {
+			auto& exp_node_binary_op = exp_tree->As<ExpNode_BinaryOp>();
+			return exp_node_binary_op.op != OperatorType::Assign && IsConstExp(exp_node_binary_op.left) && IsConstExp(exp_node_binary_op.right);
+		}
+	default: assert(false); return false;
+	}
+}
+
 int Analyzer::EvalConstExp(const ExpTree& exp_tree) {
 	assert(exp_tree != nullptr);
 	switch (exp_tree->GetType()) {
@@ -197,6 +217,14 @@ VarInfo Analyzer::AllocateTempVarInitializedWith(int value) {
 	return var_temp;
 }
 
+VarInfo Analyzer::AddConstantTable(uint length, InitializingList initializing_list) {
+	uint index = var_index_stack.front(); var_index_stack.front() += length;
+	if (var_index_stack.front() >= temp_var_index_begin) { throw compile_error("too many variables"); }
+	for (auto& [offset, value] : initializing_list) { offset += index; }
+	current_func_constant_table_list.insert(current_func_constant_table_list.end(), initializing_list.begin(), initializing_list.end());
+	return VarInfo::VarRef(true, index);
+}
+
 VarInfo Analyzer::ReadArraySubscript(const VarEntry& var_entry, const ArraySubscript& subscript) {
 	const vector<uint>& array_dimension = var_entry.GetArraySize().dimension;
 	if (subscript.size() > array_dimension.size()) { throw compile_error("expression must have a value type"); }
@@ -313,39 +341,29 @@ VarInfo Analyzer::ReadBinaryOp(const ExpNode_BinaryOp& exp_node_binary_op) {
 			AppendCodeLine(CodeLine::Assign(var_info_left, ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right)));
 		}
 		return var_info_left;
+	} else if (exp_node_binary_op.op == OperatorType::And || exp_node_binary_op.op == OperatorType::Or) {
+		uint label_false = AllocateLabel(), label_next = AllocateLabel();
+		VarInfo var_value = ReadLogicalCondition(exp_node_binary_op, label_false, false);
+		if (var_value.IsNumber()) {
+			AppendLabel(label_false); AppendLabel(label_next);
+			return var_value;
+		}
+		VarInfo var_temp = AllocateTempVar();
+		AppendCodeLine(CodeLine::Assign(var_temp, VarInfo::Number(1)));
+		AppendCodeLine(CodeLine::Goto(label_next));
+		AppendLabel(label_false);
+		AppendCodeLine(CodeLine::Assign(var_temp, VarInfo::Number(0)));
+		AppendLabel(label_next);
+		return var_temp;
 	} else {
 		VarInfo var_info_left = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.left);
-		if (exp_node_binary_op.op == OperatorType::And) {
-			if (var_info_left.IsNumber()) {
-				return var_info_left.value == 0 ? VarInfo::Number(0) : ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
-			}
-			uint label_next = AllocateLabel();
-			VarInfo var_temp = AllocateTempVarInitializedWith(0);
-			AppendCodeLine(CodeLine::JumpIfNot(label_next, var_info_left));
-			VarInfo var_info_right = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
-			AppendCodeLine(CodeLine::Assign(var_temp, var_info_right));
-			AppendLabel(label_next);
-			return var_temp;
-		} else if (exp_node_binary_op.op == OperatorType::Or) {
-			if (var_info_left.IsNumber()) {
-				return var_info_left.value != 0 ? VarInfo::Number(1) : ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
-			}
-			uint label_next = AllocateLabel();
-			VarInfo var_temp = AllocateTempVarInitializedWith(1);
-			AppendCodeLine(CodeLine::JumpIf(label_next, var_info_left));
-			VarInfo var_info_right = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
-			AppendCodeLine(CodeLine::Assign(var_temp, var_info_right));
-			AppendLabel(label_next);
-			return var_temp;
+		VarInfo var_info_right = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
+		if (var_info_left.IsNumber() && var_info_right.IsNumber()) {
+			return VarInfo::Number(EvalBinaryOperator(exp_node_binary_op.op, var_info_left.value, var_info_right.value));
 		} else {
-			VarInfo var_info_right = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
-			if (var_info_left.IsNumber() && var_info_right.IsNumber()) {
-				return VarInfo::Number(EvalBinaryOperator(exp_node_binary_op.op, var_info_left.value, var_info_right.value));
-			} else {
-				VarInfo var_temp = AllocateTempVar();
-				AppendCodeLine(CodeLine::BinaryOperation(exp_node_binary_op.op, var_temp, var_info_left, var_info_right));
-				return var_temp;
-			}
+			VarInfo var_temp = AllocateTempVar();
+			AppendCodeLine(CodeLine::BinaryOperation(exp_node_binary_op.op, var_temp, var_info_left, var_info_right));
+			return var_temp;
 		}
 	}
 }
@@ -368,6 +386,48 @@ VarInfo Analyzer::ReadExpTreeAsIntOrIntRef(const ExpTree& exp_tree) {
 	return var_info;
 }
 
+void Analyzer::AppendConstantJump(VarInfo var_value, uint label_index, bool jump_if) {
+	if ((var_value.value != 0) == jump_if) { AppendCodeLine(CodeLine::Goto(label_index)); }
+}
+
+VarInfo Analyzer::ReadLogicalCondition(const ExpNode_BinaryOp& exp_node_binary_op, uint label_index, bool jump_if) {
+	// the left operand decides the value if it is false for &&, or true for ||, skipping the right operand
+	bool short_value = exp_node_binary_op.op == OperatorType::Or;
+	uint label_short = jump_if == short_value ? label_index : AllocateLabel();
+	VarInfo var_left = ReadCondition(exp_node_binary_op.left, label_short, short_value);
+	bool is_left_number = var_left.IsNumber(), is_decided = is_left_number && (var_left.value != 0) == short_value;
+	VarInfo var_right = is_decided ? VarInfo::Number(short_value) : ReadCondition(exp_node_binary_op.right, label_index, jump_if);
+	if (!is_left_number && var_right.IsNumber()) { AppendConstantJump(var_right, label_index, jump_if); }
+	if (label_short != label_index) { AppendLabel(label_short); }
+	return is_left_number ? var_right : VarInfo::Void();
+}
+
+VarInfo Analyzer::ReadCondition(const ExpTree& exp_tree, uint label_index, bool jump_if) {
+	if (exp_tree->GetType() == ExpNodeType::UnaryOp && exp_tree->As<ExpNode_UnaryOp>().op == OperatorType::Not) {
+		VarInfo var_value = ReadCondition(exp_tree->As<ExpNode_UnaryOp>().child, label_index, !jump_if);
+		return var_value.IsNumber() ? VarInfo::Number(var_value.value == 0) : var_value;
+	}
+	if (exp_tree->GetType() == ExpNodeType::BinaryOp) {
+		const ExpNode_BinaryOp& exp_node_binary_op = exp_tree->As<ExpNode_BinaryOp>();
+		OperatorType op = exp_node_binary_op.op;
+		if (op == OperatorType::And || op == OperatorType::Or) { return ReadLogicalCondition(exp_node_binary_op, label_index, jump_if); }
+		if (op >= OperatorType::Equal && op <= OperatorType::GreaterEuqal) {
+			VarInfo var_info_left = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.left);
+			VarInfo var_info_right = ReadExpTreeAsIntOrIntRef(exp_node_binary_op.right);
+			if (var_info_left.IsNumber() && var_info_right.IsNumber()) {
+				return VarInfo::Number(EvalBinaryOperator(op, var_info_left.value, var_info_right.value));
+			}
+			if (!jump_if) { op = GetInverseCompareOperator(op); }
+			AppendCodeLine(CodeLine::JumpIf(label_index, op, var_info_left, var_info_right));
+			return VarInfo::Void();
+		}
+	}
+	VarInfo var_value = ReadExpTreeAsIntOrIntRef(exp_tree);
+	if (var_value.IsNumber()) { return var_value; }
+	AppendCodeLine(jump_if ? CodeLine::JumpIf(label_index, var_value) : CodeLine::JumpIfNot(label_index, var_value));
+	return VarInfo::Void();
+}
+
 void Analyzer::ReadLocalVarDef(const AstNode_VarDef& node_var_def) {
 	ArraySize array_size = EvalArraySize(node_var_def.array_dimension);
 	ExpTreeInitializingList exp_tree_initializing_list = GetExpTreeInitializingList(array_size, node_var_def.initializer_list);
@@ -375,10 +435,13 @@ void Analyzer::ReadLocalVarDef(const AstNode_VarDef& node_var_def) {
 		AddConstVar(node_var_def.identifier, array_size, EvalExpTreeInitializingList(exp_tree_initializing_list));
 	} else {
 		const VarEntry& var_entry = AddVar(node_var_def.identifier, array_size, false, false);
+		if (!array_size.dimension.empty()) {
+			current_func_local_array_list.push_back({ var_entry.index, var_entry.GetArraySize().length });
+		}
 		if (!node_var_def.initializer_list.empty()) {
 			uint length = var_entry.GetArraySize().length;
 			VarInfo dest_begin = VarInfo::VarRef(false, var_entry.index);
-			if (length <= 8 || exp_tree_initializing_list.size() >= length / 2) {
+			if (length <= max_element_wise_initialization_length) {
 				// initialize each element
 				uint current_offset = 0;
 				for (auto& [index, exp_tree] : exp_tree_initializing_list) {
@@ -393,18 +456,23 @@ void Analyzer::ReadLocalVarDef(const AstNode_VarDef& node_var_def) {
 					AppendCodeLine(CodeLine::Store(dest_begin, VarInfo::Number(current_offset++), VarInfo::Number(0)));
 				}
 			} else {
-				// initialize all elements to zero in a loop
-				VarInfo var_temp = AllocateTempVarInitializedWith(0);
-				uint label_loop = AllocateLabel();
-				AppendLabel(label_loop);
-				AppendCodeLine(CodeLine::Store(dest_begin, var_temp, VarInfo::Number(0)));
-				AppendCodeLine(CodeLine::BinaryOperation(OperatorType::Add, var_temp, var_temp, VarInfo::Number(1)));
-				AppendCodeLine(CodeLine::JumpIf(label_loop, OperatorType::Less, var_temp, VarInfo::Number((int)length)));
-				// initialize with initializing list
+				// copy from a constant table if at least half of the elements are nonzero constants, otherwise fill with zero
+				InitializingList constant_list;
+				for (auto& [index, exp_tree] : exp_tree_initializing_list) {
+					if (!IsConstExp(exp_tree)) { continue; }
+					if (int value = EvalConstExp(exp_tree); value != 0) { constant_list.push_back({ index, value }); }
+				}
+				bool is_copied = constant_list.size() >= length / 2;
+				if (is_copied) {
+					AppendCodeLine(CodeLine::MemCopy(dest_begin, VarInfo::Number((int)length), AddConstantTable(length, std::move(constant_list))));
+				} else {
+					AppendCodeLine(CodeLine::Fill(dest_begin, VarInfo::Number((int)length), VarInfo::Number(0)));
+				}
+				// store the other elements, in order of the initializing list
 				for (auto& [index, exp_tree] : exp_tree_initializing_list) {
+					if (IsConstExp(exp_tree) && (is_copied || EvalConstExp(exp_tree) == 0)) { continue; }
 					VarInfo src = ReadExpTreeAsIntOrIntRef(exp_tree);
-					VarInfo dest_offset = VarInfo::Number(index);
-					AppendCodeLine(CodeLine::Store(dest_begin, dest_offset, src));
+					AppendCodeLine(CodeLine::Store(dest_begin, VarInfo::Number(index), src));
 				}
 			}
 		}
@@ -420,12 +488,12 @@ void Analyzer::ReadBlock(const AstNode_Block& node_block) {
 }
 
 void Analyzer::ReadIf(const AstNode_If& node_if) {
-	VarInfo var_expression_value = ReadExpTreeAsIntOrIntRef(node_if.expression);
+	uint label_else = AllocateLabel();
+	VarInfo var_expression_value = ReadCondition(node_if.expression, label_else, false);
 	if (var_expression_value.IsNumber()) {
+		AppendLabel(label_else);
 		return var_expression_value.value != 0 ? ReadLocalBlock(node_if.then_block) : ReadLocalBlock(node_if.else_block);
 	}
-	uint label_else = AllocateLabel();
-	AppendCodeLine(CodeLine::JumpIfNot(label_else, var_expression_value));
 	ReadLocalBlock(node_if.then_block);
 	uint label_next = AllocateLabel();
 	AppendCodeLine(CodeLine::Goto(label_next));
@@ -435,22 +503,26 @@ void Analyzer::ReadIf(const AstNode_If& node_if) {
 }
 
 void Analyzer::ReadWhile(const AstNode_While& node_while) {
-	uint old_label_continue = label_continue;
+	// rotated to a do-while loop entered at its test, so that each iteration ends with a single jump back
+	uint old_label_continue = label_continue, old_label_break = label_break;
 	label_continue = AllocateLabel();
-	AppendLabel(label_continue);
-	VarInfo var_expression_value = ReadExpTreeAsIntOrIntRef(node_while.expression);
-	if (!(var_expression_value.IsNumber() && var_expression_value.value == 0)) {
-		uint old_label_break = label_break;
-		label_break = AllocateLabel();
-		if (!var_expression_value.IsNumber()) { 
-			AppendCodeLine(CodeLine::JumpIfNot(label_break, var_expression_value)); 
-		}
+	label_break = AllocateLabel();
+	uint label_body = AllocateLabel();
+	bool is_const = IsConstExp(node_while.expression), const_value = is_const && EvalConstExp(node_while.expression) != 0;
+	if (!is_const || const_value) {
+		if (!is_const) { AppendCodeLine(CodeLine::Goto(label_continue)); }
+		AppendLabel(label_body);
 		ReadLocalBlock(node_while.block);
-		AppendCodeLine(CodeLine::Goto(label_continue));
-		AppendLabel(label_break);
-		label_break = old_label_break;
+		AppendLabel(label_continue);
+		VarInfo var_test_value = ReadCondition(node_while.expression, label_body, true);
+		if (var_test_value.IsNumber()) { AppendConstantJump(var_test_value, label_body, true); }
+	} else {
+		AppendLabel(label_body);
+		AppendLabel(label_continue);
 	}
+	AppendLabel(label_break);
 	label_continue = old_label_continue;
+	label_break = old_label_break;
 }
 
 void Analyzer::ReadBreak(const AstNode_Break& node_break) {
@@ -539,7 +611,9 @@ GlobalFuncDef Analyzer::ReadGlobalFuncDef(const AstNode_FuncDef& func_def) {
 	assert(current_func_code_block.empty());
 	is_return_type_int = func_def.is_int;
 	max_local_var_size = 0;
+	current_temp_var_count = 0;
 	assert(current_func_label_map.empty());
+	assert(current_func_local_array_list.empty());
 	current_label_count = 0;
 	assert(label_break == -1);
 	assert(label_continue == -1);
@@ -547,9 +621,10 @@ GlobalFuncDef Analyzer::ReadGlobalFuncDef(const AstNode_FuncDef& func_def) {
 	AddGlobalFunc(func_def.identifier, func_def.is_int, GetParameterTypeList());
 	ReadLocalBlock(func_def.block);
 	RemoveParameterList();
+	uint local_var_length = PackTempVar(current_func_code_block, current_func_label_map, current_temp_var_count, max_local_var_size);
 	return GlobalFuncDef{
-		(uint)func_def.parameter_list.size(), max_local_var_size, func_def.is_int,
-		std::move(current_func_code_block), std::move(current_func_label_map)
+		(uint)func_def.parameter_list.size(), local_var_length, func_def.is_int,
+		std::move(current_func_code_block), std::move(current_func_label_map), std::move(current_func_local_array_list)
 	};
 }
 
@@ -578,6 +653,9 @@ LinearCode Analyzer::ReadGlobalBlock(const Block& block) {
 			break;
 		case AstNodeType::FuncDef:
 			linear_code.global_func_table.push_back(ReadGlobalFuncDef(node->As<AstNode_FuncDef>()));
+			// constant tables of the function are placed after the global variables before it
+			[](auto& dest, auto& src) { dest.insert(dest.end(), src.begin(), src.end()); src.clear(); }
+			(linear_code.global_var_table.initializing_list, current_func_constant_table_list);
 			break;
 		default:
 			throw compile_error("expected a declaration");
@@ -3,6 +3,7 @@
 #include "syntax_tree.h"
 #include "symbol_table.h"
 #include "linear_code.h"
+#include "temp_var_packer.h"
 
 
 class Analyzer {
@@ -11,7 +12,11 @@ private:
 	LocalVarIndexStack var_index_stack;
 	FuncSymbolTable func_symbol_table;
 private:
-	uint AllocateVarIndex(uint length) { uint index = var_index_stack.back(); var_index_stack.back() += length; return index; }
+	uint AllocateVarIndex(uint length) {
+		uint index = var_index_stack.back(); var_index_stack.back() += length;
+		if (var_index_stack.back() >= temp_var_index_begin) { throw compile_error("too many variables"); }
+		return index;
+	}
 	uint AllocateFuncIndex() { return (uint)func_symbol_table.size(); }
 private:
 	const VarEntry& AddVar(string_view identifier, const ArraySize& array_size, bool is_global, bool is_parameter);
@@ -25,6 +30,7 @@ private:
 	const FuncEntry& FindFunc(string_view identifier);
 
 private:
+	bool IsConstExp(const ExpTree& exp_tree);  // if it can be evaluated by EvalConstExp
 	int EvalConstExp(const ExpTree& exp_tree);
 	ArrayIndex EvalArrayIndex(const ArraySubscript& array_subscript);
 	ArraySize EvalArraySize(const ArrayDimension& array_dimension);
@@ -49,6 +55,7 @@ private:
 	uint max_local_var_size = 0;
 
 	LabelMap current_func_label_map;
+	LocalArrayList current_func_local_array_list;
 	uint current_label_count = 0;
 	uint label_break = -1;
 	uint label_continue = -1;
@@ -56,12 +63,18 @@ private:
 	bool is_assignment = false;
 	uint current_var_addr_index = -1;
 
+	uint current_temp_var_count = 0;  // temporaries are packed after the function is read
+
+	// global tables of constant initial values copied to local arrays, added to the global variable table after the function
+	InitializingList current_func_constant_table_list;
+
 private:
 	uint AllocateLabel() { return current_label_count++; }
 	void AppendLabel(uint label_index);
 	void AppendCodeLine(CodeLine code_line) { current_func_code_block.push_back(code_line); }
-	VarInfo AllocateTempVar() { return VarInfo::Temp(AllocateVarIndex(1)); }
+	VarInfo AllocateTempVar() { return VarInfo::Temp(temp_var_index_begin + current_temp_var_count++); }
 	VarInfo AllocateTempVarInitializedWith(int value);
+	VarInfo AddConstantTable(uint length, InitializingList initializing_list);
 
 private:
 	VarInfo ReadArraySubscript(const VarEntry& var_entry, const ArraySubscript& subscript);
@@ -71,8 +84,16 @@ private:
 	VarInfo ReadBinaryOp(const ExpNode_BinaryOp& exp_node_binary_op);
 	VarInfo ReadExpTree(const ExpTree& exp_tree);
 	VarInfo ReadExpTreeAsIntOrIntRef(const ExpTree& exp_tree);
+private:
+	// Conditions jump to the label if their value is jump_if, or fall through, and short circuits jump past the rest.
+	//   A constant condition is returned as a number with no jump appended, otherwise Void is returned.
+	void AppendConstantJump(VarInfo var_value, uint label_index, bool jump_if);
+	VarInfo ReadLogicalCondition(const ExpNode_BinaryOp& exp_node_binary_op, uint label_index, bool jump_if);
+	VarInfo ReadCondition(const ExpTree& exp_tree, uint label_index, bool jump_if);
 
 private:
+	// Longer arrays are filled with zero or copied from a constant table first, then the other elements are stored.
+	static constexpr uint max_element_wise_initialization_length = 8;
 	void ReadLocalVarDef(const AstNode_VarDef& node_var_def);
 	void ReadExp(const AstNode_Exp& node_exp);
 	void ReadBlock(const AstNode_Block& node_block);
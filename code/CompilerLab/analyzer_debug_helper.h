@@ -4,6 +4,7 @@
 #include "library_function.h"
 
 #include <iostream>
+#include <functional>
 
 
 using std::cout;
@@ -22,6 +23,11 @@ inline std::ostream& operator<<(std::ostream& os, std::pair<CodeLineVarType, int
 
 
 class AnalyzerDebugHelper {
+private:
+	std::ostream& os;
+public:
+	AnalyzerDebugHelper(std::ostream& os = cout) : os(os) {}
+
 private:
 	static std::pair<CodeLineVarType, int> VarInfo(const CodeLine& line, int index) {
 		assert(index >= 0 && index < 3);
@@ -31,40 +37,46 @@ public:
 	void PrintCodeLine(const CodeLine& line) {
 		switch (line.type) {
 		case CodeLineType::BinaryOp:
-			cout << VarInfo(line, 0) << " = " << VarInfo(line, 1) << " " << GetOperatorString(line.op) << " " << VarInfo(line, 2) << endl;
+			os << VarInfo(line, 0) << " = " << VarInfo(line, 1) << " " << GetOperatorString(line.op) << " " << VarInfo(line, 2) << endl;
 			break;
 		case CodeLineType::UnaryOp:
-			cout << VarInfo(line, 0) << " = " << GetOperatorString(line.op) << VarInfo(line, 1) << endl;
+			os << VarInfo(line, 0) << " = " << GetOperatorString(line.op) << VarInfo(line, 1) << endl;
 			break;
 		case CodeLineType::Addr:
-			cout << VarInfo(line, 0) << " = &" << VarInfo(line, 1) << "[" << VarInfo(line, 2) << "]" << endl;
+			os << VarInfo(line, 0) << " = &" << VarInfo(line, 1) << "[" << VarInfo(line, 2) << "]" << endl;
 			break;
 		case CodeLineType::Load:
-			cout << VarInfo(line, 0) << " = " << VarInfo(line, 1) << "[" << VarInfo(line, 2) << "]" << endl;
+			os << VarInfo(line, 0) << " = " << VarInfo(line, 1) << "[" << VarInfo(line, 2) << "]" << endl;
 			break;
 		case CodeLineType::Store:
-			cout << VarInfo(line, 0) << "[" << VarInfo(line, 1) << "]" << " = " << VarInfo(line, 2) << endl;
+			os << VarInfo(line, 0) << "[" << VarInfo(line, 1) << "]" << " = " << VarInfo(line, 2) << endl;
 			break;
 		case CodeLineType::FuncCall:
-			line.var_type[1] == CodeLineVarType::Type::Empty ? cout : cout << VarInfo(line, 1) << " = ";
+			line.var_type[1] == CodeLineVarType::Type::Empty ? os : os << VarInfo(line, 1) << " = ";
 			if (IsLibraryFunc(line.var[0])) {
-				cout << "call " << GetLibraryFuncString(line.var[0]) << endl;
+				os << "call " << GetLibraryFuncString(line.var[0]) << endl;
 			} else {
-				cout << "call f" << line.var[0] << endl;
+				os << "call f" << line.var[0] << endl;
 			}
 			break;
 		case CodeLineType::Parameter:
-			cout << "param " << VarInfo(line, 0) << endl;
+			os << "param " << VarInfo(line, 0) << endl;
 			break;
 		case CodeLineType::JumpIf:
-			cout << "goto " << GetLabelLineNo(line.var[0]) << " if " << VarInfo(line, 1) << " " << GetOperatorString(line.op) << " " << VarInfo(line, 2) << endl;
+			os << "goto " << GetLabelLineNo(line.var[0]) << " if " << VarInfo(line, 1) << " " << GetOperatorString(line.op) << " " << VarInfo(line, 2) << endl;
 			break;
 		case CodeLineType::Goto:
-			cout << "goto " << GetLabelLineNo(line.var[0]) << endl;
+			os << "goto " << GetLabelLineNo(line.var[0]) << endl;
 			break;
 		case CodeLineType::Return:
-			cout << "return";
-			line.var_type[0] == CodeLineVarType::Type::Empty ? cout << endl : cout << " " << VarInfo(line, 0) << endl;
+			os << "return";
+			line.var_type[0] == CodeLineVarType::Type::Empty ? os << endl : os << " " << VarInfo(line, 0) << endl;
+			break;
+		case CodeLineType::Fill:
+			os << VarInfo(line, 0) << "[0:" << VarInfo(line, 1) << "] = " << VarInfo(line, 2) << endl;
+			break;
+		case CodeLineType::MemCopy:
+			os << VarInfo(line, 0) << "[0:" << VarInfo(line, 1) << "] = " << VarInfo(line, 2) << "[0:" << VarInfo(line, 1) << "]" << endl;
 			break;
 		default:
 			assert(false);
@@ -81,26 +93,34 @@ private:
 
 private:
 	void PrintGlobalVar(const GlobalVarTable& global_var_table) {
-		cout << global_var_table.length << endl;
+		os << global_var_table.length << endl;
 		for (auto& [index, val] : global_var_table.initializing_list) {
-			cout << "\t[" << index << "] " << val << endl;
+			os << "\t[" << index << "] " << val << endl;
 		}
 	}
 	void PrintGlobalFunc(const GlobalFuncTable& global_func_table) {
 		uint counter = library_func_number;
 		for (auto& global_func : global_func_table) {
-			cout << "func" << counter++ << ": " << global_func.parameter_count << " " << global_func.local_var_length << endl;
-			current_func_label_map = &global_func.label_map;
-			for (uint i = 0; i < global_func.code_block.size(); ++i) {
-				cout << i << '\t';
-				PrintCodeLine(global_func.code_block[i]);
-			}
+			PrintFuncDef(global_func, counter++, [&](uint line_no) { os << line_no << '\t'; });
 		}
 	}
 public:
+	// print_line_prefix is called before each line is printed, for annotating the code
+	void PrintFuncDef(const GlobalFuncDef& func_def, uint func_index, const std::function<void(uint line_no)>& print_line_prefix) {
+		os << "func" << func_index << ": " << func_def.parameter_count << " " << func_def.local_var_length << endl;
+		current_func_label_map = &func_def.label_map;
+		for (uint i = 0; i < func_def.code_block.size(); ++i) {
+			print_line_prefix(i);
+			PrintCodeLine(func_def.code_block[i]);
+		}
+	}
+	void PrintFuncCodeLine(const GlobalFuncDef& func_def, uint line_no) {
+		current_func_label_map = &func_def.label_map;
+		PrintCodeLine(func_def.code_block[line_no]);
+	}
 	void PrintLinearCode(const LinearCode& linear_code) {
 		PrintGlobalVar(linear_code.global_var_table);
 		PrintGlobalFunc(linear_code.global_func_table);
-		cout << "main function is " << linear_code.main_func_index << endl;
+		os << "main function is " << linear_code.main_func_index << endl;
 	}
 };
\ No newline at end of file
@@ -203,6 +203,16 @@ void Generator::StoreAddrVar(VarInfo var, Register reg) {
 	}
 }
 
+void Generator::AddOffsetVar(Register reg_addr, VarInfo offset) {
+	if (offset.type == VarType::Number) {
+		if (offset.value != 0) { AddRegNumber(reg_addr, reg_addr, (int)((uint)offset.value * 4)); }
+		return;
+	}
+	LoadValueVar(t2, offset);
+	ShiftLeftRegNumber(t2, t2, 2);
+	AddReg(reg_addr, reg_addr, t2);
+}
+
 void Generator::LoadValueParameter(Register reg, VarInfo var) {
 	assert(var.IsValid());
 	switch (var.type) {
@@ -282,6 +292,46 @@ void Generator::ReadBranch(uint label_index, OperatorType op, Register rs1, Regi
 	}
 }
 
+// Short ranges are stored word by word, longer ones in a loop storing 4 words each iteration after the remainder.
+void Generator::ReadFill(const CodeLine& line) {
+	VarInfo length(line, 1);
+	assert(length.type == VarType::Number);
+	uint count = (uint)length.value;
+	LoadAddrVar(t1, VarInfo(line, 0));
+	LoadValueVar(t2, VarInfo(line, 2));
+	uint unrolled_count = count <= max_unrolled_fill_length ? count : count % 4;
+	for (uint i = 0; i < unrolled_count; ++i) {
+		out << "\t" << "sw " << t2 << ", " << i * 4 << "(" << t1 << ")" << endl;
+	}
+	if (unrolled_count == count) { return; }
+	if (unrolled_count > 0) { AddRegNumber(t1, t1, (int)unrolled_count * 4); }
+	LoadValueNumber(t0, (int)(count - unrolled_count) * 4);
+	AddReg(t0, t0, t1);
+	out << "1:" << endl;
+	for (uint i = 0; i < 4; ++i) {
+		out << "\t" << "sw " << t2 << ", " << i * 4 << "(" << t1 << ")" << endl;
+	}
+	AddRegNumber(t1, t1, 16);
+	out << "\t" << "bne " << t1 << ", " << t0 << ", 1b" << endl;
+}
+
+// copies a word each iteration, with a0 as the scratch register
+void Generator::ReadMemCopy(const CodeLine& line) {
+	VarInfo length(line, 1);
+	assert(length.type == VarType::Number);
+	if (length.value == 0) { return; }
+	LoadAddrVar(t1, VarInfo(line, 0));
+	LoadAddrVar(t2, VarInfo(line, 2));
+	LoadValueNumber(t0, (int)((uint)length.value * 4));
+	AddReg(t0, t0, t1);
+	out << "1:" << endl;
+	out << "\t" << "lw " << a0 << ", 0(" << t2 << ")" << endl;
+	out << "\t" << "sw " << a0 << ", 0(" << t1 << ")" << endl;
+	AddRegNumber(t1, t1, 4);
+	AddRegNumber(t2, t2, 4);
+	out << "\t" << "bne " << t1 << ", " << t0 << ", 1b" << endl;
+}
+
 void Generator::ReadCodeLine(const CodeBlock& code_block, uint& line_no) {
 	assert(line_no < code_block.size());
 	//out << endl;
@@ -300,27 +350,27 @@ void Generator::ReadCodeLine(const CodeBlock& code_block, uint& line_no) {
 		break;
 	case CodeLineType::Addr:
 		LoadAddrVar(t1, VarInfo(line, 1));
-		LoadValueVar(t2, VarInfo(line, 2));
-		ShiftLeftRegNumber(t2, t2, 2);
-		AddReg(t1, t1, t2);
+		AddOffsetVar(t1, VarInfo(line, 2));
 		StoreAddrVar(VarInfo(line, 0), t1);
 		break;
 	case CodeLineType::Load:
 		LoadAddrVar(t1, VarInfo(line, 1));
-		LoadValueVar(t2, VarInfo(line, 2));
-		ShiftLeftRegNumber(t2, t2, 2);
-		AddReg(t1, t1, t2);
+		AddOffsetVar(t1, VarInfo(line, 2));
 		LoadValueGlobalAddr(t1, t1);
 		StoreValueVar(VarInfo(line, 0), t1);
 		break;
 	case CodeLineType::Store:
 		LoadAddrVar(t1, VarInfo(line, 0));
-		LoadValueVar(t2, VarInfo(line, 1));
-		ShiftLeftRegNumber(t2, t2, 2);
-		AddReg(t1, t1, t2);
+		AddOffsetVar(t1, VarInfo(line, 1));
 		LoadValueVar(t2, VarInfo(line, 2));
 		StoreValueGlobalAddr(t1, t2);
 		break;
+	case CodeLineType::Fill:
+		ReadFill(line);
+		break;
+	case CodeLineType::MemCopy:
+		ReadMemCopy(line);
+		break;
 	case CodeLineType::FuncCall:
 		ReadFuncCall(code_block, line_no);
 		break;
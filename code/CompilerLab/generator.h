@@ -20,6 +20,7 @@ private:
 	static constexpr int max_imm12_int_value = 2047;
 	static constexpr int min_imm12_int_value = -2048;
 	static constexpr char global_var_base_label[2] = "g";
+	static constexpr uint max_unrolled_fill_length = 8;
 
 private:
 	Register t0 = Register::Temp(0);
@@ -68,6 +69,7 @@ private:
 	void StoreValueVar(VarInfo var, Register reg);
 	void LoadAddrVar(Register reg, VarInfo var);
 	void StoreAddrVar(VarInfo var, Register reg);
+	void AddOffsetVar(Register reg_addr, VarInfo offset);  // reg_addr += offset * 4, with t2
 	void LoadValueParameter(Register reg, VarInfo var);
 
 private:
@@ -83,6 +85,8 @@ private:
 	uint LoadFuncParameter(const CodeBlock& code_block, uint line_no);
 	void ReadFuncCall(const CodeBlock& code_block, uint& line_no);
 	void ReadBranch(uint label_index, OperatorType op, Register rs1, Register rs2);
+	void ReadFill(const CodeLine& line);
+	void ReadMemCopy(const CodeLine& line);
 private:
 	void ReadCodeLine(const CodeBlock& code_block, uint& line_no);
 	void ReadCodeBlock(const CodeBlock& code_block);
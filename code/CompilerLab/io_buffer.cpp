@@ -0,0 +1,106 @@
+#include "io_buffer.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+InputBuffer::~InputBuffer() {
+#ifndef _WIN32
+	if (mapped_addr != nullptr) { munmap(mapped_addr, mapped_size); }
+#endif
+}
+
+bool InputBuffer::MapInput() {
+#ifndef _WIN32
+	struct stat file_stat;
+	if (fstat(STDIN_FILENO, &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) { return false; }
+	off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+	if (offset < 0 || offset >= file_stat.st_size) { return false; }
+	off_t page_offset = offset / sysconf(_SC_PAGESIZE) * sysconf(_SC_PAGESIZE);
+	size_t size = (size_t)(file_stat.st_size - page_offset);
+	void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, STDIN_FILENO, page_offset);
+	if (addr == MAP_FAILED) { return false; }
+	madvise(addr, size, MADV_SEQUENTIAL);
+	lseek(STDIN_FILENO, 0, SEEK_END);
+	mapped_addr = addr; mapped_size = size;
+	current = (const char*)addr + (offset - page_offset);
+	end = (const char*)addr + size;
+	return true;
+#else
+	return false;
+#endif
+}
+
+bool InputBuffer::Refill() {
+	if (is_end_of_input) { return false; }
+	if (mapped_addr == nullptr && buffer.empty() && MapInput()) { return true; }
+	if (mapped_addr != nullptr) { is_end_of_input = true; return false; }
+	buffer.resize(buffer_size);
+#ifdef _WIN32
+	int length = _read(0, buffer.data(), (uint)buffer_size);
+#else
+	ssize_t length = read(STDIN_FILENO, buffer.data(), buffer_size);
+#endif
+	if (length <= 0) { is_end_of_input = true; return false; }
+	current = buffer.data();
+	end = buffer.data() + length;
+	return true;
+}
+
+int InputBuffer::ReadInt() {
+	int c = PeekChar();
+	while (c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' || c == '\f') { current++; c = PeekChar(); }
+	bool is_negative = c == '-';
+	if (c == '-' || c == '+') { current++; c = PeekChar(); }
+	uint value = 0;
+	while (c >= '0' && c <= '9') {
+		value = value * 10 + (uint)(c - '0');
+		current++; c = PeekChar();
+	}
+	return (int)(is_negative ? 0 - value : value);
+}
+
+bool InputBuffer::ReadLine(string& line) {
+	line.clear();
+	int c = ReadChar();
+	if (c == -1) { return false; }
+	for (; c != -1 && c != '\n'; c = ReadChar()) { line.push_back((char)c); }
+	if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+	return true;
+}
+
+
+void OutputBuffer::WriteInt(int value) {
+	static constexpr char digit_pairs[] =
+		"00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+		"40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+		"8081828384858687888990919293949596979899";
+	if (buffer_size - length < 11) { Flush(); }
+	uint abs_value = value < 0 ? 0 - (uint)value : (uint)value;
+	if (value < 0) { buffer[length++] = '-'; }
+	char digits[10]; uint count = 0;
+	while (abs_value >= 100) {
+		uint pair = abs_value % 100; abs_value /= 100;
+		digits[count++] = digit_pairs[pair * 2 + 1];
+		digits[count++] = digit_pairs[pair * 2];
+	}
+	if (abs_value >= 10) {
+		digits[count++] = digit_pairs[abs_value * 2 + 1];
+		digits[count++] = digit_pairs[abs_value * 2];
+	} else {
+		digits[count++] = (char)('0' + abs_value);
+	}
+	while (count > 0) { buffer[length++] = digits[--count]; }
+}
+
+void OutputBuffer::Flush() {
+	if (length > 0) { fwrite(buffer.data(), 1, length, stdout); length = 0; }
+	fflush(stdout);
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "core.h"
+
+#include <string>
+#include <vector>
+
+
+using std::string;
+using std::vector;
+
+
+// Reads the standard input through a large buffer, or through a mapping of the rest of the input
+//   if it's a regular file. Returns -1 for a character read at the end of the input.
+// The standard input is read ahead, or seeked to its end when mapped, so once an InputBuffer is used
+//   nothing else, like std::cin, may read the standard input.
+class InputBuffer {
+private:
+	static constexpr size_t buffer_size = 1 << 16;
+	vector<char> buffer;
+	ref_ptr<const char> current = nullptr;
+	ref_ptr<const char> end = nullptr;
+	bool is_end_of_input = false;
+
+	alloc_ptr<void> mapped_addr = nullptr;
+	size_t mapped_size = 0;
+
+public:
+	InputBuffer() {}
+	~InputBuffer();
+
+private:
+	bool MapInput();
+	bool Refill();
+
+public:
+	int PeekChar() {
+		if (current == end && !Refill()) { return -1; }
+		return (uchar)*current;
+	}
+	int ReadChar() {
+		if (current == end && !Refill()) { return -1; }
+		return (uchar)*current++;
+	}
+	int ReadInt();	// skips leading whitespaces, returns 0 if there's no integer
+	bool ReadLine(string& line);  // without the line break, returns false at the end of the input
+};
+
+
+// Writes the standard output through a large buffer, which is flushed when full or explicitly.
+class OutputBuffer {
+private:
+	static constexpr size_t buffer_size = 1 << 16;
+	vector<char> buffer = vector<char>(buffer_size);
+	size_t length = 0;
+
+public:
+	~OutputBuffer() { Flush(); }
+
+public:
+	void WriteChar(char c) {
+		if (length == buffer_size) { Flush(); }
+		buffer[length++] = c;
+	}
+	void WriteInt(int value);
+	void Flush();
+};
\ No newline at end of file
@@ -2,6 +2,7 @@
 
 #include <array>
 #include <algorithm>
+#include <climits>
 
 
 struct OperatorInfo {
@@ -90,6 +91,30 @@ int EvalBinaryOperator(OperatorType op, int value_left, int value_right) {
 	}
 }
 
+bool EvalBinaryOperatorAsRuntime(OperatorType op, int value_left, int value_right, int& result) {
+	switch (op) {
+	case OperatorType::Add: result = (int)((uint)value_left + (uint)value_right); return true;
+	case OperatorType::Sub: result = (int)((uint)value_left - (uint)value_right); return true;
+	case OperatorType::Mul: result = (int)((uint)value_left * (uint)value_right); return true;
+	case OperatorType::Div: case OperatorType::Mod:
+		if (value_right == 0 || (value_left == INT_MIN && value_right == -1)) { return false; }
+		result = EvalBinaryOperator(op, value_left, value_right); return true;
+	default: result = EvalBinaryOperator(op, value_left, value_right); return true;
+	}
+}
+
+OperatorType GetInverseCompareOperator(OperatorType op) {
+	switch (op) {
+	case OperatorType::Equal: return OperatorType::NotEqual;
+	case OperatorType::NotEqual: return OperatorType::Equal;
+	case OperatorType::Less: return OperatorType::GreaterEuqal;
+	case OperatorType::Greater: return OperatorType::LessEqual;
+	case OperatorType::LessEqual: return OperatorType::Greater;
+	case OperatorType::GreaterEuqal: return OperatorType::Less;
+	default: assert(false); return OperatorType::None;
+	}
+}
+
 
 struct BracketInfo {
 	char left;
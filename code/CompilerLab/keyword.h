@@ -39,6 +39,8 @@ int GetBinaryOperatorPriority(OperatorType op);  // (highest) 0 --- 8 (lowest)
 
 int EvalUnaryOperator(OperatorType op, int value);
 int EvalBinaryOperator(OperatorType op, int value_left, int value_right);
+bool EvalBinaryOperatorAsRuntime(OperatorType op, int value_left, int value_right, int& result);  // wraps, false if it traps
+OperatorType GetInverseCompareOperator(OperatorType op);  // a == b <=> !(a != b)
 
 
 enum class BracketType : uchar {
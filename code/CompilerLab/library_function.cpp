@@ -1,67 +1,151 @@
 #include "symbol_table.h"
 
+#include "io_buffer.h"
+
+#include <chrono>
+#include <iomanip>
 #include <iostream>
+#include <map>
 
 
 using FuncPtr = void(*)(const Argument& arg0, const Argument& arg1, int& return_value);
 
 
+static InputBuffer input_buffer;
+static OutputBuffer output_buffer;
+
+
+int LibraryGetInt() {
+	return input_buffer.ReadInt();
+}
+int LibraryGetCh() {
+	return input_buffer.ReadChar();
+}
+int LibraryGetArray(ref_ptr<int> array_addr, uint array_size) {
+	int n = input_buffer.ReadInt();
+	for (int i = 0; i < n; i++) {
+		if (i >= (int)array_size) { throw std::runtime_error("array subscript out of range"); }
+		array_addr[i] = input_buffer.ReadInt();
+	}
+	return n;
+}
+void LibraryPutInt(int value) {
+	output_buffer.WriteInt(value);
+}
+void LibraryPutCh(int value) {
+	output_buffer.WriteChar((char)value);
+}
+void LibraryPutArray(int n, ref_ptr<int> array_addr, uint array_size) {
+	output_buffer.WriteInt(n);
+	output_buffer.WriteChar(':');
+	for (int i = 0; i < n; i++) { 
+		if (i >= (int)array_size) { throw std::runtime_error("array subscript out of range"); }
+		output_buffer.WriteChar(' ');
+		output_buffer.WriteInt(array_addr[i]);
+	}
+	output_buffer.WriteChar('\n');
+}
+
+bool LibraryReadLine(string& line) {
+	return input_buffer.ReadLine(line);
+}
+
+
+
+
+// Each timed region is identified by the lines of its starttime and stoptime, and regions may be nested.
+//   The time of a region is accumulated over all its runs, and the total is the time of the outermost regions.
+using TimerClock = std::chrono::steady_clock;
+
+struct TimerRecord {
+	TimerClock::duration time = TimerClock::duration::zero();
+	uint64 hit_count = 0;
+};
+
+struct TimerStart {
+	int line_no;
+	TimerClock::time_point time;
+};
+
+static vector<TimerStart> timer_stack;
+static std::map<std::pair<int, int>, TimerRecord> timer_record_map;
+static TimerClock::duration timer_total_time = TimerClock::duration::zero();
+
+void LibraryStartTime(int line_no) {
+	timer_stack.push_back(TimerStart{ line_no, TimerClock::now() });
+}
+void LibraryStopTime(int line_no) {
+	TimerClock::time_point time = TimerClock::now();
+	if (timer_stack.empty()) { return; }  // unmatched stoptime
+	TimerStart start = timer_stack.back(); timer_stack.pop_back();
+	TimerRecord& record = timer_record_map[{ start.line_no, line_no }];
+	record.time += time - start.time;
+	record.hit_count++;
+	if (timer_stack.empty()) { timer_total_time += time - start.time; }
+}
+
+void PrintTimerDuration(std::ostream& os, TimerClock::duration time) {
+	uint64 us = (uint64)std::chrono::duration_cast<std::chrono::microseconds>(time).count();
+	os << us / 3600000000 << "H-" << us / 60000000 % 60 << "M-" << us / 1000000 % 60 << "S-" << us % 1000000 << "us";
+}
+
+void PrintTimerSummary(std::ostream& os) {
+	if (timer_record_map.empty()) { return; }
+	for (auto& [lines, record] : timer_record_map) {
+		os << "Timer@" << std::setfill('0') << std::setw(4) << lines.first << "-" << std::setw(4) << lines.second
+			<< std::setfill(' ') << ": ";
+		PrintTimerDuration(os, record.time);
+		os << " (" << record.hit_count << (record.hit_count == 1 ? " hit)" : " hits)") << std::endl;
+	}
+	os << "TOTAL: ";
+	PrintTimerDuration(os, timer_total_time);
+	os << std::endl;
+}
+
+
 void GetInt(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsEmpty() && arg1.IsEmpty());
-	std::cin >> return_value;
+	return_value = LibraryGetInt();
 }
 void GetCh(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsEmpty() && arg1.IsEmpty());
-	char c;
-	std::cin >> c; 
-	return_value = (int)c;
+	return_value = LibraryGetCh();
 }
 void GetArray(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsArray() && arg1.IsEmpty());
-	int n; std::cin >> n;
-	for (int i = 0; i < n; i++) {
-		if (i >= (int)arg0.array_size) { throw std::runtime_error("array subscript out of range"); }
-		std::cin >> arg0.array_addr[i];
-	}
-	return_value = n;
+	return_value = LibraryGetArray(arg0.array_addr, arg0.array_size);
 }
 void PutInt(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsInt() && arg1.IsEmpty());
-	std::cout << arg0.value;
+	LibraryPutInt(arg0.value);
 }
 void PutCh(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsInt() && arg1.IsEmpty());
-	std::cout << (char)arg0.value;
+	LibraryPutCh(arg0.value);
 }
 void PutArray(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsInt() && arg1.IsArray());
-	std::cout << arg0.value;
-	for (int i = 0; i < arg0.value; i++) { 
-		if (i >= (int)arg1.array_size) { throw std::runtime_error("array subscript out of range"); }
-		std::cout << arg1.array_addr[i];
-	}
-	std::cout << std::endl;
+	LibraryPutArray(arg0.value, arg1.array_addr, arg1.array_size);
 }
-
-
-
-
 void StartTime(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsInt() && arg1.IsEmpty());
-
+	LibraryStartTime(arg0.value);
 }
 void StopTime(const Argument& arg0, const Argument& arg1, int& return_value) {
 	assert(arg0.IsInt() && arg1.IsEmpty());
-
+	LibraryStopTime(arg0.value);
 }
 
 
 void LibraryInitialize() {
-
+	timer_stack.clear();
+	timer_record_map.clear();
+	timer_total_time = TimerClock::duration::zero();
 }
 
 void LibraryUninitialize() {
-
+	output_buffer.Flush();
+	PrintTimerSummary(std::cerr);
 }
 
 
@@ -5,6 +5,7 @@
 #include <string>
 
 
+using std::string;
 using std::string_view;
 
 
@@ -12,6 +13,8 @@ constexpr uint library_func_number = 8;
 
 constexpr bool IsLibraryFunc(uint func_index) { return func_index < library_func_number; }
 
+enum class LibraryFunc : uint { GetInt, GetCh, GetArray, PutInt, PutCh, PutArray, StartTime, StopTime };
+
 string_view GetLibraryFuncString(uint library_func_index);
 uint GetLibraryFuncParameterCount(uint library_func_index);
 
@@ -35,4 +38,18 @@ public:
 
 void CallLibraryFunc(uint library_func_index, const Argument& arg0, const Argument& arg1, int& return_value);
 void LibraryInitialize();
-void LibraryUninitialize();
\ No newline at end of file
+void LibraryUninitialize();
+
+
+// Library functions with typed parameters, for callers binding each call at compile time.
+int LibraryGetInt();
+int LibraryGetCh();
+int LibraryGetArray(ref_ptr<int> array_addr, uint array_size);
+void LibraryPutInt(int value);
+void LibraryPutCh(int value);
+void LibraryPutArray(int n, ref_ptr<int> array_addr, uint array_size);
+void LibraryStartTime(int line_no);
+void LibraryStopTime(int line_no);
+
+// Reads a line from the standard input shared with the library functions, returns false at the end of the input.
+bool LibraryReadLine(string& line);
\ No newline at end of file
@@ -15,6 +15,8 @@ enum class CodeLineType : uchar {
 	JumpIf,		//	jo	l0	x1	x2
 	Goto,		//	gt	l0
 	Return,		//	rt	x0
+	Fill,		//	fl	x0	x1	x2
+	MemCopy,	//	mc	x0	x1	x2
 };
 
 
@@ -107,6 +109,18 @@ private:
 		type(CodeLineType::Return), op(OperatorType::None), var_type{ var }, var{ var.value }{
 		assert(var_type[0].IsIntOrRef());
 	}
+	// x0[0, x1) = x2 or x0[0, x1) = x2[0, x1), with the length x1 a number
+	CodeLine(CodeLineType type, const VarInfo& dest_begin, const VarInfo& length, const VarInfo& src) :
+		type(type), op(OperatorType::None),
+		var_type{ dest_begin, length, src }, var{ dest_begin.value, length.value, src.value }{
+		assert(type == CodeLineType::Fill || type == CodeLineType::MemCopy);
+		assert(var_type[0].IsRefOrAddr() && var_type[1] == CodeLineVarType::Type::Number && length.value >= 0);
+		assert(type == CodeLineType::Fill ? var_type[2].IsIntOrRef() : var_type[2].IsRefOrAddr());
+	}
+	CodeLine(const CodeLine& line, int var0, int var1, int var2) :
+		type(line.type), op(line.op),
+		var_type{ line.var_type[0], line.var_type[1], line.var_type[2] }, var{ var0, var1, var2 } {
+	}
 
 public:
 	static CodeLine BinaryOperation(OperatorType op, const VarInfo& dest, const VarInfo& src1, const VarInfo& src2) {
@@ -155,6 +169,15 @@ public:
 	static CodeLine ReturnInt(const VarInfo& var) {
 		return CodeLine(true, var);
 	}
+	static CodeLine Fill(const VarInfo& dest_begin, const VarInfo& length, const VarInfo& src) {
+		return CodeLine(CodeLineType::Fill, dest_begin, length, src);
+	}
+	static CodeLine MemCopy(const VarInfo& dest_begin, const VarInfo& length, const VarInfo& src_begin) {
+		return CodeLine(CodeLineType::MemCopy, dest_begin, length, src_begin);
+	}
+	static CodeLine ReplaceVar(const CodeLine& line, int var0, int var1, int var2) {
+		return CodeLine(line, var0, var1, var2);
+	}
 };
 
 static_assert(sizeof(CodeLine) == 16);
@@ -170,6 +193,7 @@ struct GlobalVarTable {
 
 using CodeBlock = vector<CodeLine>;
 using LabelMap = vector<uint>;
+using LocalArrayList = vector<std::pair<uint, uint>>;  // (index, length)
 
 struct GlobalFuncDef {
 	uint parameter_count;
@@ -177,6 +201,7 @@ struct GlobalFuncDef {
 	bool is_int;
 	CodeBlock code_block;
 	LabelMap label_map;
+	LocalArrayList local_array_list;  // elements of local arrays may be accessed at an offset, other local variables are not; arrays of sibling blocks may overlap
 };
 
 using GlobalFuncTable = vector<GlobalFuncDef>;
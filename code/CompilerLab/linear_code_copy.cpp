@@ -0,0 +1,110 @@
+#include "linear_code_copy.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+
+namespace {
+
+class CopyPropagator {
+private:
+	FuncIR& func_ir;
+	vector<IROperand> leader;  // the operand each register is replaced with
+	std::unordered_map<uint64, IROperand> memory_value;  // of scalars in memory assigned in the current block
+
+public:
+	CopyPropagator(FuncIR& func_ir) : func_ir(func_ir), leader(func_ir.GetRegCount()) {
+		for (uint reg = 0; reg < func_ir.GetRegCount(); ++reg) { leader[reg] = IROperand::Reg(reg); }
+	}
+
+private:
+	static uint64 GetMemoryKey(const IROperand& operand) { return (uint64)operand.type << 32 | (uint)operand.value; }
+	IROperand Resolve(IROperand operand) const {
+		while (operand.IsReg() && leader[operand.GetReg()] != operand) { operand = leader[operand.GetReg()]; }
+		return operand;
+	}
+	void Forward(IROperand& src) const {
+		if (!src.IsMemory()) { return; }
+		if (auto it = memory_value.find(GetMemoryKey(src)); it != memory_value.end()) { src = it->second; }
+	}
+	void InvalidateArray(const IROperand& base);  // for a store at an unknown offset
+	bool VisitInstr(IRInstr& instr);  // returns true if the instruction is removed
+public:
+	void Run();
+};
+
+void CopyPropagator::InvalidateArray(const IROperand& base) {
+	if (base.type != IROperandType::Local) { memory_value.clear(); return; }  // a global array or a pointer to any array
+	uint array = func_ir.GetLocalArray(base.value);
+	if (array == -1) { memory_value.clear(); return; }
+	auto [index, length] = func_ir.local_array_list[array];  // slots of all arrays sharing the base
+	for (auto it = memory_value.begin(); it != memory_value.end();) {
+		bool is_element = (IROperandType)(it->first >> 32) == IROperandType::Local && (uint)it->first - index < length;
+		it = is_element ? memory_value.erase(it) : std::next(it);
+	}
+}
+
+bool CopyPropagator::VisitInstr(IRInstr& instr) {
+	switch (instr.type) {
+	case IRInstrType::BinaryOp: Forward(instr.var[1]); Forward(instr.var[2]); break;
+	case IRInstrType::UnaryOp: case IRInstrType::Copy: Forward(instr.var[1]); break;
+	case IRInstrType::Addr: case IRInstrType::Load: Forward(instr.var[2]); break;
+	case IRInstrType::Store: Forward(instr.var[1]); Forward(instr.var[2]); break;
+	case IRInstrType::Fill: Forward(instr.var[2]); break;
+	case IRInstrType::Call: for (IROperand& argument : instr.argument_list) { Forward(argument); } break;
+	default: break;
+	}
+	switch (instr.type) {
+	case IRInstrType::Copy:
+		if (instr.var[0].IsReg()) {
+			if (instr.var[1].IsMemory()) { return false; }
+			leader[instr.var[0].GetReg()] = instr.var[1];
+			return true;
+		} else {
+			uint64 key = GetMemoryKey(instr.var[0]);
+			IROperand value = Resolve(instr.var[1]);
+			if (value == instr.var[0]) { return true; }
+			if (auto it = memory_value.find(key); it != memory_value.end() && Resolve(it->second) == value) { return true; }
+			if (value.IsMemory()) { memory_value.erase(key); } else { memory_value[key] = value; }
+			return false;
+		}
+	case IRInstrType::Store:
+		if (instr.var[0].IsMemory() && instr.var[1].IsNumber()) {
+			IROperand dest = instr.var[0]; dest.value += instr.var[1].value;
+			if (instr.var[2].IsMemory()) { memory_value.erase(GetMemoryKey(dest)); } else { memory_value[GetMemoryKey(dest)] = instr.var[2]; }
+		} else {
+			InvalidateArray(instr.var[0]);
+		}
+		return false;
+	case IRInstrType::Fill: case IRInstrType::MemCopy:
+		InvalidateArray(instr.var[0]);
+		return false;
+	case IRInstrType::Call:
+		memory_value.clear();
+		return false;
+	default:
+		return false;
+	}
+}
+
+void CopyPropagator::Run() {
+	for (IRBlock& ir_block : func_ir.block_list) {
+		memory_value.clear();
+		ir_block.instr_list.erase(std::remove_if(ir_block.instr_list.begin(), ir_block.instr_list.end(), [&](IRInstr& instr) {
+			return VisitInstr(instr);
+		}), ir_block.instr_list.end());
+		ir_block.ForEachExitSrc([&](IROperand& src) { Forward(src); });
+	}
+	for (IRBlock& ir_block : func_ir.block_list) {
+		for (IRInstr& instr : ir_block.instr_list) { instr.ForEachSrc([&](IROperand& src) { src = Resolve(src); }); }
+		ir_block.ForEachExitSrc([&](IROperand& src) { src = Resolve(src); });
+	}
+}
+
+} // namespace
+
+
+void PropagateCopy(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	CopyPropagator(func_ir).Run();
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Copy propagation over a FuncIR in SSA form. Copies of registers and numbers are removed with their sources
+//   forwarded to all uses. A scalar in memory assigned in a block is replaced with the value assigned at later reads
+//   in the block, until a call or a store which may overwrite it, and assigning the value it already holds is removed.
+void PropagateCopy(FuncIR& func_ir);
\ No newline at end of file
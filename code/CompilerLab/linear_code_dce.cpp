@@ -0,0 +1,240 @@
+#include "linear_code_dce.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+
+namespace {
+
+enum class MemoryAccessType : uchar { Read, ReadAtOffset, Write, WriteAtOffset, Escape };
+
+struct MemoryAccess {
+	MemoryAccessType type;
+	uint slot;  // the element accessed, or the base for an unknown offset
+};
+
+
+// Local arrays are only accessed by memory operands of their elements, or by bases with offsets unless their
+//   addresses are taken. An array read at unknown offsets is live as a whole, others are live element by element.
+class DeadStoreEliminator {
+private:
+	FuncIR& func_ir;
+	vector<IRBlock>& block_list;
+	vector<bool> is_escaped, is_read, is_read_at_offset;
+	vector<uint> array_unit;  // for arrays live as a whole
+	std::unordered_map<uint, uint> element_unit;  // for elements of other arrays read
+	uint unit_count = 0;
+
+public:
+	DeadStoreEliminator(FuncIR& func_ir);
+
+private:
+	static void GetAccessList(const IRInstr& instr, vector<MemoryAccess>& access_list);  // reads before the write
+	static void GetAccessList(const IRBlock& block, vector<MemoryAccess>& access_list);  // of the exit
+	uint GetArray(uint slot) const { return func_ir.GetLocalArray(slot); }
+	bool IsTracked(uint array) const { return array != -1 && !is_escaped[array]; }
+	uint GetUnit(uint array, uint slot) const {
+		return array_unit[array] != -1 ? array_unit[array] : element_unit.at(slot);
+	}
+public:
+	void Run();
+};
+
+DeadStoreEliminator::DeadStoreEliminator(FuncIR& func_ir) :
+	func_ir(func_ir), block_list(func_ir.block_list) {
+	const uint array_count = (uint)func_ir.local_array_list.size();
+	is_escaped.assign(array_count, false); is_read.assign(array_count, false); is_read_at_offset.assign(array_count, false);
+	vector<MemoryAccess> access_list;
+	auto ForEachAccess = [&](auto func) {
+		for (const IRBlock& ir_block : block_list) {
+			for (const IRInstr& instr : ir_block.instr_list) { GetAccessList(instr, access_list); for (auto& access : access_list) { func(access); } }
+			GetAccessList(ir_block, access_list); for (auto& access : access_list) { func(access); }
+		}
+	};
+	ForEachAccess([&](const MemoryAccess& access) {
+		uint array = GetArray(access.slot);
+		if (array == -1) { return; }
+		switch (access.type) {
+		case MemoryAccessType::Escape: is_escaped[array] = true; break;
+		case MemoryAccessType::ReadAtOffset: is_read_at_offset[array] = true; is_read[array] = true; break;
+		case MemoryAccessType::Read: is_read[array] = true; break;
+		default: break;
+		}
+	});
+	array_unit.assign(array_count, -1);
+	for (uint array = 0; array < array_count; ++array) {
+		if (is_read_at_offset[array] && IsTracked(array)) { array_unit[array] = unit_count++; }
+	}
+	ForEachAccess([&](const MemoryAccess& access) {
+		uint array = GetArray(access.slot);
+		if (!IsTracked(array) || !is_read[array] || array_unit[array] != -1) { return; }
+		if (access.type == MemoryAccessType::Read || access.type == MemoryAccessType::Write) {
+			if (element_unit.emplace(access.slot, unit_count).second) { unit_count++; }
+		}
+	});
+}
+
+void DeadStoreEliminator::GetAccessList(const IRInstr& instr, vector<MemoryAccess>& access_list) {
+	access_list.clear();
+	auto Read = [&](const IROperand& src) {
+		if (src.type == IROperandType::Local) { access_list.push_back({ MemoryAccessType::Read, (uint)src.value }); }
+	};
+	auto AccessAt = [&](const IROperand& base, const IROperand& offset, MemoryAccessType type, MemoryAccessType type_at_offset) {
+		if (base.type != IROperandType::Local) { return; }
+		if (offset.IsNumber()) {
+			access_list.push_back({ type, (uint)(base.value + offset.value) });
+		} else {
+			access_list.push_back({ type_at_offset, (uint)base.value });
+		}
+	};
+	switch (instr.type) {
+	case IRInstrType::Addr:
+		Read(instr.var[2]);
+		if (instr.var[1].type == IROperandType::Local) { access_list.push_back({ MemoryAccessType::Escape, (uint)instr.var[1].value }); }
+		break;
+	case IRInstrType::Load:
+		Read(instr.var[2]);
+		AccessAt(instr.var[1], instr.var[2], MemoryAccessType::Read, MemoryAccessType::ReadAtOffset);
+		break;
+	case IRInstrType::Store:
+		Read(instr.var[1]); Read(instr.var[2]);
+		AccessAt(instr.var[0], instr.var[1], MemoryAccessType::Write, MemoryAccessType::WriteAtOffset);
+		break;
+	case IRInstrType::Fill:
+		Read(instr.var[2]);
+		AccessAt(instr.var[0], IROperand(), MemoryAccessType::Write, MemoryAccessType::WriteAtOffset);
+		break;
+	case IRInstrType::MemCopy:
+		AccessAt(instr.var[2], IROperand(), MemoryAccessType::Read, MemoryAccessType::ReadAtOffset);
+		AccessAt(instr.var[0], IROperand(), MemoryAccessType::Write, MemoryAccessType::WriteAtOffset);
+		break;
+	default:
+		instr.ForEachSrc(Read);
+		break;
+	}
+	if (instr.HasDest() && instr.GetDest().type == IROperandType::Local) {
+		access_list.push_back({ MemoryAccessType::Write, (uint)instr.GetDest().value });
+	}
+}
+
+void DeadStoreEliminator::GetAccessList(const IRBlock& ir_block, vector<MemoryAccess>& access_list) {
+	access_list.clear();
+	ir_block.ForEachExitSrc([&](const IROperand& src) {
+		if (src.type == IROperandType::Local) { access_list.push_back({ MemoryAccessType::Read, (uint)src.value }); }
+	});
+}
+
+void DeadStoreEliminator::Run() {
+	const uint block_count = (uint)block_list.size();
+	vector<MemoryAccess> access_list;
+
+	// solve the liveness of units, as bit sets of each block, where writes to elements kill
+	const uint word_count = (unit_count + 63) / 64;
+	vector<vector<uint64>> live_in(block_count, vector<uint64>(word_count)), live_out(block_count, vector<uint64>(word_count));
+	vector<vector<uint64>> use_set(block_count, vector<uint64>(word_count)), def_set(block_count, vector<uint64>(word_count));
+	auto SetBit = [](vector<uint64>& set, uint index) { set[index / 64] |= (uint64)1 << (index % 64); };
+	auto ResetBit = [](vector<uint64>& set, uint index) { set[index / 64] &= ~((uint64)1 << (index % 64)); };
+	auto GetBit = [](const vector<uint64>& set, uint index) { return (set[index / 64] >> (index % 64) & 1) != 0; };
+	auto ForEachUnitAccess = [&](const vector<MemoryAccess>& access_list, auto read, auto kill) {
+		for (const MemoryAccess& access : access_list) {
+			uint array = GetArray(access.slot);
+			if (!IsTracked(array) || !is_read[array]) { continue; }
+			if (access.type == MemoryAccessType::Read || access.type == MemoryAccessType::ReadAtOffset) { read(GetUnit(array, access.slot)); }
+			if (access.type == MemoryAccessType::Write && array_unit[array] == -1) { kill(GetUnit(array, access.slot)); }
+		}
+	};
+	if (word_count > 0) {
+		for (uint block = 0; block < block_count; ++block) {
+			auto Read = [&](uint unit) { if (!GetBit(def_set[block], unit)) { SetBit(use_set[block], unit); } };
+			auto Kill = [&](uint unit) { SetBit(def_set[block], unit); };
+			for (const IRInstr& instr : block_list[block].instr_list) { GetAccessList(instr, access_list); ForEachUnitAccess(access_list, Read, Kill); }
+			GetAccessList(block_list[block], access_list); ForEachUnitAccess(access_list, Read, Kill);
+		}
+		for (bool is_changed = true; is_changed;) {
+			is_changed = false;
+			for (uint block = block_count; block-- > 0;) {
+				for (uint word = 0; word < word_count; ++word) {
+					uint64 out = 0;
+					for (uint successor : block_list[block].GetSuccessorList()) { out |= live_in[successor][word]; }
+					uint64 in = use_set[block][word] | (out & ~def_set[block][word]);
+					if (in != live_in[block][word]) { live_in[block][word] = in; is_changed = true; }
+					live_out[block][word] = out;
+				}
+			}
+		}
+	}
+
+	// remove writes not live afterwards, scanning each block backward
+	for (uint block = 0; block < block_count; ++block) {
+		IRBlock& ir_block = block_list[block];
+		vector<uint64>& live = live_out[block];
+		auto Read = [&](uint unit) { SetBit(live, unit); };
+		auto Kill = [&](uint unit) { ResetBit(live, unit); };
+		GetAccessList(ir_block, access_list); ForEachUnitAccess(access_list, Read, Kill);
+		vector<bool> is_dead(ir_block.instr_list.size(), false);
+		for (uint index = (uint)ir_block.instr_list.size(); index-- > 0;) {
+			const IRInstr& instr = ir_block.instr_list[index];
+			GetAccessList(instr, access_list);
+			if (!access_list.empty() && instr.type != IRInstrType::Call) {
+				const MemoryAccess& write = access_list.back();
+				uint array = GetArray(write.slot);
+				if ((write.type == MemoryAccessType::Write || write.type == MemoryAccessType::WriteAtOffset) && IsTracked(array)) {
+					is_dead[index] = !is_read[array] || (write.type == MemoryAccessType::Write && !GetBit(live, GetUnit(array, write.slot)));
+				}
+			}
+			if (is_dead[index]) { continue; }
+			std::reverse(access_list.begin(), access_list.end());
+			ForEachUnitAccess(access_list, Read, Kill);
+		}
+		uint index = 0;
+		ir_block.instr_list.erase(std::remove_if(ir_block.instr_list.begin(), ir_block.instr_list.end(), [&](const IRInstr&) {
+			return is_dead[index++];
+		}), ir_block.instr_list.end());
+	}
+}
+
+
+// Marks registers used by instructions with side effects and by exits, and those they depend on.
+void RemoveUnusedInstr(FuncIR& func_ir) {
+	vector<IRBlock>& block_list = func_ir.block_list;
+	vector<bool> is_live(func_ir.GetRegCount(), false);
+	vector<IRSite> def_site(func_ir.GetRegCount(), IRSite{ (uint)-1, (uint)-1 });
+	vector<uint> work_list;
+	auto MarkLive = [&](const IROperand& src) {
+		if (src.IsReg() && !is_live[src.GetReg()]) { is_live[src.GetReg()] = true; work_list.push_back(src.GetReg()); }
+	};
+	auto IsRemovable = [](const IRInstr& instr) {
+		return instr.type != IRInstrType::Store && instr.type != IRInstrType::Call && instr.HasDest() && instr.GetDest().IsReg();
+	};
+	for (uint block = 0; block < block_list.size(); ++block) {
+		for (uint index = 0; index < block_list[block].instr_list.size(); ++index) {
+			const IRInstr& instr = block_list[block].instr_list[index];
+			if (IsRemovable(instr)) { def_site[instr.GetDest().GetReg()] = { block, index }; } else { instr.ForEachSrc(MarkLive); }
+		}
+		block_list[block].ForEachExitSrc(MarkLive);
+	}
+	while (!work_list.empty()) {
+		uint reg = work_list.back(); work_list.pop_back();
+		if (def_site[reg].block != -1) { block_list[def_site[reg].block].instr_list[def_site[reg].index].ForEachSrc(MarkLive); }
+	}
+	for (IRBlock& ir_block : block_list) {
+		ir_block.instr_list.erase(std::remove_if(ir_block.instr_list.begin(), ir_block.instr_list.end(), [&](const IRInstr& instr) {
+			return IsRemovable(instr) && !is_live[instr.GetDest().GetReg()];
+		}), ir_block.instr_list.end());
+		for (IRInstr& instr : ir_block.instr_list) {
+			if (instr.type == IRInstrType::Call && instr.HasDest() && instr.GetDest().IsReg() && !is_live[instr.GetDest().GetReg()]) {
+				instr.var[0] = IROperand();  // the result is discarded
+			}
+		}
+	}
+}
+
+} // namespace
+
+
+void EliminateDeadCode(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	func_ir.RemoveUnreachableBlock();
+	DeadStoreEliminator(func_ir).Run();
+	RemoveUnusedInstr(func_ir);
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Removes stores to local arrays which are not read afterwards, then instructions whose results are not used,
+//   over a FuncIR in SSA form. Calls, stores to globals or through pointers, and stores to local arrays whose
+//   addresses are taken are kept. Arrays only read at constant offsets are tracked element by element;
+//   arrays of sibling blocks sharing slots are tracked as one array.
+void EliminateDeadCode(FuncIR& func_ir);
\ No newline at end of file
@@ -0,0 +1,67 @@
+#include "linear_code_dominator.h"
+
+
+// The iterative algorithm by Cooper, Harvey and Kennedy, which is fast for the shallow trees of structured code.
+DominatorTree::DominatorTree(const FuncIR& func_ir) :
+	order(func_ir.GetReversePostOrder()), order_index(func_ir.block_list.size(), -1),
+	idom(func_ir.block_list.size(), -1), child_list(func_ir.block_list.size()) {
+	assert(order.size() == func_ir.block_list.size());
+	for (uint i = 0; i < order.size(); ++i) { order_index[order[i]] = i; }
+	auto Intersect = [&](uint block_a, uint block_b) {
+		while (block_a != block_b) {
+			while (order_index[block_a] > order_index[block_b]) { block_a = idom[block_a]; }
+			while (order_index[block_b] > order_index[block_a]) { block_b = idom[block_b]; }
+		}
+		return block_a;
+	};
+	idom[0] = 0;
+	for (bool is_changed = true; is_changed;) {
+		is_changed = false;
+		for (uint i = 1; i < order.size(); ++i) {
+			uint block = order[i], new_idom = -1;
+			for (uint predecessor : func_ir.block_list[block].predecessor_list) {
+				if (idom[predecessor] == -1) { continue; }
+				new_idom = new_idom == -1 ? predecessor : Intersect(predecessor, new_idom);
+			}
+			if (idom[block] != new_idom) { idom[block] = new_idom; is_changed = true; }
+		}
+	}
+	idom[0] = -1;
+	for (uint i = 1; i < order.size(); ++i) { child_list[idom[order[i]]].push_back(order[i]); }
+	preorder_begin.resize(order.size()); preorder_end.resize(order.size());
+	uint counter = 0;
+	vector<std::pair<uint, uint>> stack{ { 0, 0 } };  // (block, next child)
+	preorder_begin[0] = counter++;
+	while (!stack.empty()) {
+		auto& [block, child] = stack.back();
+		if (child < child_list[block].size()) {
+			uint child_block = child_list[block][child++];
+			preorder_begin[child_block] = counter++;
+			stack.push_back({ child_block, 0 });
+		} else {
+			preorder_end[block] = counter;
+			stack.pop_back();
+		}
+	}
+}
+
+vector<uint> DominatorTree::GetPreorder() const {
+	vector<uint> preorder(order.size());
+	for (uint block = 0; block < order.size(); ++block) { preorder[preorder_begin[block]] = block; }
+	return preorder;
+}
+
+vector<vector<uint>> DominatorTree::GetDominanceFrontier(const FuncIR& func_ir) const {
+	vector<vector<uint>> frontier(order.size());
+	for (uint block = 0; block < order.size(); ++block) {
+		const vector<uint>& predecessor_list = func_ir.block_list[block].predecessor_list;
+		if (predecessor_list.size() < 2) { continue; }
+		for (uint runner : predecessor_list) {
+			while (runner != idom[block]) {
+				if (frontier[runner].empty() || frontier[runner].back() != block) { frontier[runner].push_back(block); }
+				runner = idom[runner];
+			}
+		}
+	}
+	return frontier;
+}
\ No newline at end of file
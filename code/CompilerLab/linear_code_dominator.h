@@ -0,0 +1,25 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// The dominator tree of the blocks of a FuncIR, all reachable from the entry.
+class DominatorTree {
+public:
+	vector<uint> order;  // reverse post order
+	vector<uint> order_index;
+	vector<uint> idom;  // the immediate dominator, -1 for the entry
+	vector<vector<uint>> child_list;
+private:
+	vector<uint> preorder_begin, preorder_end;  // the range of each subtree in the preorder of the tree
+
+public:
+	DominatorTree(const FuncIR& func_ir);
+
+public:
+	bool Dominates(uint block_a, uint block_b) const {
+		return preorder_begin[block_a] <= preorder_begin[block_b] && preorder_end[block_b] <= preorder_end[block_a];
+	}
+	vector<uint> GetPreorder() const;
+	vector<vector<uint>> GetDominanceFrontier(const FuncIR& func_ir) const;
+};
\ No newline at end of file
@@ -0,0 +1,206 @@
+#include "linear_code_gvn.h"
+#include "linear_code_dominator.h"
+
+#include <algorithm>
+#include <tuple>
+#include <unordered_map>
+
+
+namespace {
+
+struct ValueKey {
+	IRInstrType type;
+	OperatorType op;
+	IROperand var[2];
+
+public:
+	bool operator==(const ValueKey& other) const {
+		return type == other.type && op == other.op && var[0] == other.var[0] && var[1] == other.var[1];
+	}
+};
+
+struct ValueKeyHash {
+	size_t operator()(const ValueKey& key) const {
+		size_t hash = (size_t)key.type * 31 + (size_t)key.op;
+		for (const IROperand& operand : key.var) { hash = hash * 1000003 + (size_t)operand.type * 0x9E3779B9 + (size_t)(uint)operand.value; }
+		return hash;
+	}
+};
+
+bool IsCommutativeOperator(OperatorType op) {
+	switch (op) {
+	case OperatorType::Add: case OperatorType::Mul: case OperatorType::And: case OperatorType::Or:
+	case OperatorType::Equal: case OperatorType::NotEqual:
+		return true;
+	default:
+		return false;
+	}
+}
+
+// Returns the operand x op y always equals, or an empty operand.
+IROperand SimplifyBinaryOp(OperatorType op, const IROperand& left, const IROperand& right) {
+	switch (op) {
+	case OperatorType::Add:
+		if (left.IsNumber(0)) { return right; }
+		if (right.IsNumber(0)) { return left; }
+		break;
+	case OperatorType::Sub:
+		if (right.IsNumber(0)) { return left; }
+		if (left.IsReg() && left == right) { return IROperand::Number(0); }
+		break;
+	case OperatorType::Mul:
+		if (left.IsNumber(1)) { return right; }
+		if (right.IsNumber(1)) { return left; }
+		if (left.IsNumber(0) || right.IsNumber(0)) { return IROperand::Number(0); }
+		break;
+	case OperatorType::Div:
+		if (right.IsNumber(1)) { return left; }
+		break;
+	default:
+		break;
+	}
+	return IROperand();
+}
+
+// The key of a memory access, where an element at a constant offset is always a memory operand.
+ValueKey GetMemoryKey(IROperand base, const IROperand& offset) {
+	if (base.IsMemory() && offset.IsNumber()) {
+		base.value += offset.value;
+		return ValueKey{ IRInstrType::Copy, OperatorType::None, { base } };
+	}
+	return ValueKey{ IRInstrType::Load, OperatorType::None, { base, offset } };
+}
+
+
+class ValueNumbering {
+private:
+	FuncIR& func_ir;
+	vector<IRBlock>& block_list;
+	vector<IROperand> leader;  // the operand each register is replaced with
+	std::unordered_map<ValueKey, uint, ValueKeyHash> value_table;  // of the blocks dominating the current block
+	vector<ValueKey> value_log;
+	std::unordered_map<ValueKey, IROperand, ValueKeyHash> load_table;  // of the current block, since the last store or call
+
+public:
+	ValueNumbering(FuncIR& func_ir) : func_ir(func_ir), block_list(func_ir.block_list), leader(func_ir.GetRegCount()) {
+		for (uint reg = 0; reg < func_ir.GetRegCount(); ++reg) { leader[reg] = IROperand::Reg(reg); }
+	}
+
+private:
+	IROperand Resolve(IROperand operand) const {
+		while (operand.IsReg() && leader[operand.GetReg()] != operand) { operand = leader[operand.GetReg()]; }
+		return operand;
+	}
+	bool FindOrInsertValue(const ValueKey& key, uint reg) {
+		auto [it, is_inserted] = value_table.emplace(key, reg);
+		if (is_inserted) { value_log.push_back(key); return false; }
+		leader[reg] = IROperand::Reg(it->second);
+		return true;
+	}
+	bool FindOrInsertLoad(const ValueKey& key, uint reg) {
+		auto [it, is_inserted] = load_table.emplace(key, IROperand::Reg(reg));
+		if (is_inserted) { return false; }
+		leader[reg] = it->second;
+		return true;
+	}
+	bool VisitInstr(IRInstr& instr);  // returns true if the instruction is redundant
+public:
+	void Run();
+};
+
+bool ValueNumbering::VisitInstr(IRInstr& instr) {
+	instr.ForEachSrc([&](IROperand& src) { src = Resolve(src); });
+	if (instr.IsMemoryWrite() || instr.type == IRInstrType::Call || (instr.HasDest() && instr.GetDest().IsMemory())) {
+		load_table.clear();
+		if (instr.type == IRInstrType::Store && !instr.var[2].IsMemory()) {
+			load_table.emplace(GetMemoryKey(instr.var[0], instr.var[1]), instr.var[2]);
+		}
+		if (instr.type == IRInstrType::Copy && !instr.var[1].IsMemory()) {
+			load_table.emplace(GetMemoryKey(instr.var[0], IROperand::Number(0)), instr.var[1]);
+		}
+		return false;
+	}
+	if (!instr.HasDest()) { return false; }
+	uint reg = instr.GetDest().GetReg();
+	switch (instr.type) {
+	case IRInstrType::Phi: {
+		IROperand value;
+		for (const IROperand& argument : instr.argument_list) {
+			if (argument.IsReg(reg) || argument == value) { continue; }
+			if (!value.IsEmpty() || argument.IsMemory()) { return false; }
+			value = argument;
+		}
+		if (value.IsEmpty()) { return false; }
+		leader[reg] = value;
+		return true;
+	}
+	case IRInstrType::Copy:
+		if (instr.var[1].IsMemory()) { return FindOrInsertLoad(GetMemoryKey(instr.var[1], IROperand::Number(0)), reg); }
+		leader[reg] = instr.var[1];
+		return true;
+	case IRInstrType::Load:
+		return FindOrInsertLoad(GetMemoryKey(instr.var[1], instr.var[2]), reg);
+	case IRInstrType::BinaryOp: {
+		int result;
+		if (instr.var[1].IsNumber() && instr.var[2].IsNumber() &&
+			EvalBinaryOperatorAsRuntime(instr.op, instr.var[1].value, instr.var[2].value, result)) {
+			leader[reg] = IROperand::Number(result); return true;
+		}
+		IROperand value = SimplifyBinaryOp(instr.op, instr.var[1], instr.var[2]);
+		if (!value.IsEmpty() && !value.IsMemory()) { leader[reg] = value; return true; }
+		if (instr.var[1].IsMemory() || instr.var[2].IsMemory()) { return false; }
+		ValueKey key{ IRInstrType::BinaryOp, instr.op, { instr.var[1], instr.var[2] } };
+		if (IsCommutativeOperator(instr.op) && std::make_tuple(key.var[1].type, key.var[1].value) < std::make_tuple(key.var[0].type, key.var[0].value)) {
+			std::swap(key.var[0], key.var[1]);
+		}
+		return FindOrInsertValue(key, reg);
+	}
+	case IRInstrType::UnaryOp:
+		if (instr.op == OperatorType::Add && !instr.var[1].IsMemory()) { leader[reg] = instr.var[1]; return true; }
+		if (instr.var[1].IsMemory()) { return false; }
+		return FindOrInsertValue(ValueKey{ IRInstrType::UnaryOp, instr.op, { instr.var[1] } }, reg);
+	case IRInstrType::Addr:  // the address of a memory base is a constant
+		if (instr.var[2].IsMemory()) { return false; }
+		return FindOrInsertValue(ValueKey{ IRInstrType::Addr, OperatorType::None, { instr.var[1], instr.var[2] } }, reg);
+	default:
+		return false;
+	}
+}
+
+void ValueNumbering::Run() {
+	DominatorTree dominator_tree(func_ir);
+	vector<std::tuple<uint, uint, size_t>> stack{ { 0, 0, 0 } };  // (block, next child, log size when entered)
+	for (bool is_entered = false; !stack.empty();) {
+		auto& [block, child, log_size] = stack.back();
+		if (!is_entered) {
+			IRBlock& ir_block = block_list[block];
+			load_table.clear();
+			ir_block.instr_list.erase(std::remove_if(ir_block.instr_list.begin(), ir_block.instr_list.end(), [&](IRInstr& instr) {
+				return VisitInstr(instr);
+			}), ir_block.instr_list.end());
+			ir_block.ForEachExitSrc([&](IROperand& src) { src = Resolve(src); });
+		}
+		if (child < dominator_tree.child_list[block].size()) {
+			uint child_block = dominator_tree.child_list[block][child++];
+			stack.push_back({ child_block, 0, value_log.size() });
+			is_entered = false;
+		} else {
+			while (value_log.size() > log_size) { value_table.erase(value_log.back()); value_log.pop_back(); }
+			stack.pop_back();
+			is_entered = true;
+		}
+	}
+	// phis may use registers replaced in blocks visited later
+	for (IRBlock& ir_block : block_list) {
+		for (IRInstr& instr : ir_block.instr_list) { instr.ForEachSrc([&](IROperand& src) { src = Resolve(src); }); }
+	}
+}
+
+} // namespace
+
+
+void NumberValue(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	func_ir.RemoveUnreachableBlock();
+	ValueNumbering(func_ir).Run();
+}
\ No newline at end of file
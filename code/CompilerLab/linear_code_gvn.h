@@ -0,0 +1,9 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Global value numbering over a FuncIR in SSA form, in the preorder of the dominator tree. An arithmetic
+//   or address computation available from a dominating block is reused, copies and trivial phis are folded,
+//   and simple identities like x + 0 are applied. Loads are only reused within a block, until a store or a call.
+void NumberValue(FuncIR& func_ir);
\ No newline at end of file
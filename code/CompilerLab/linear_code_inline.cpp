@@ -0,0 +1,180 @@
+#include "linear_code_inline.h"
+#include "library_function.h"
+
+
+namespace {
+
+constexpr uint inline_size_threshold = 16;  // beyond the call overhead saved
+constexpr uint single_call_size_limit = 1024;
+constexpr uint caller_size_limit = 8192;
+
+uint GetSize(const FuncIR& func_ir) {
+	uint size = (uint)func_ir.block_list.size();
+	for (const IRBlock& ir_block : func_ir.block_list) { size += (uint)ir_block.instr_list.size(); }
+	return size;
+}
+
+// The call with its parameters and the frame of the callee saving each argument, and numbers may be folded in the callee.
+uint GetCallOverhead(const IRInstr& call) {
+	uint overhead = 2 + 2 * (uint)call.argument_list.size();
+	for (auto& argument : call.argument_list) { if (argument.IsNumber()) { overhead += 2; } }
+	return overhead;
+}
+
+template<class Func>
+void ForEachCallee(const FuncIR& func_ir, Func func) {
+	for (const IRBlock& ir_block : func_ir.block_list) {
+		for (const IRInstr& instr : ir_block.instr_list) {
+			if (instr.type == IRInstrType::Call && !IsLibraryFunc(instr.func_index)) { func(instr.func_index - library_func_number); }
+		}
+	}
+}
+
+
+class Inliner {
+private:
+	vector<FuncIR>& func_list;
+	vector<vector<uint>> callee_list;  // before inlining, may be repeated
+	vector<bool> is_recursive;
+	vector<uint> call_count;  // of all call sites
+	vector<uint> size;
+
+public:
+	Inliner(vector<FuncIR>& func_list);
+
+private:
+	vector<uint> GetPostOrder() const;
+	bool IsInlinable(uint caller, const IRInstr& call) const;
+	void InlineCall(uint caller, uint block, uint index);
+	void InlineCallee(uint caller);
+public:
+	void Run() { for (uint func : GetPostOrder()) { InlineCallee(func); } }
+};
+
+Inliner::Inliner(vector<FuncIR>& func_list) :
+	func_list(func_list), callee_list(func_list.size()), is_recursive(func_list.size(), false), call_count(func_list.size(), 0) {
+	for (uint func = 0; func < func_list.size(); ++func) {
+		assert(!func_list[func].is_ssa);
+		ForEachCallee(func_list[func], [&](uint callee) { callee_list[func].push_back(callee); call_count[callee]++; });
+		size.push_back(GetSize(func_list[func]));
+	}
+	for (uint func = 0; func < func_list.size(); ++func) {
+		vector<bool> is_visited(func_list.size(), false);
+		vector<uint> work_list = callee_list[func];
+		while (!work_list.empty() && !is_recursive[func]) {
+			uint callee = work_list.back(); work_list.pop_back();
+			if (callee == func) { is_recursive[func] = true; }
+			if (is_visited[callee]) { continue; }
+			is_visited[callee] = true;
+			work_list.insert(work_list.end(), callee_list[callee].begin(), callee_list[callee].end());
+		}
+	}
+}
+
+vector<uint> Inliner::GetPostOrder() const {
+	vector<uint> order; order.reserve(func_list.size());
+	vector<bool> is_visited(func_list.size(), false);
+	for (uint root = 0; root < func_list.size(); ++root) {
+		if (is_visited[root]) { continue; }
+		vector<std::pair<uint, uint>> stack;  // (function, index of the next callee)
+		is_visited[root] = true; stack.push_back({ root, 0 });
+		while (!stack.empty()) {
+			auto& [func, index] = stack.back();
+			if (index == callee_list[func].size()) { order.push_back(func); stack.pop_back(); continue; }
+			uint callee = callee_list[func][index++];
+			if (!is_visited[callee]) { is_visited[callee] = true; stack.push_back({ callee, 0 }); }
+		}
+	}
+	return order;
+}
+
+bool Inliner::IsInlinable(uint caller, const IRInstr& call) const {
+	uint callee = call.func_index - library_func_number;
+	if (callee == caller || is_recursive[callee] || size[caller] + size[callee] > caller_size_limit) { return false; }
+	return size[callee] <= GetCallOverhead(call) + inline_size_threshold || (call_count[callee] == 1 && size[callee] <= single_call_size_limit);
+}
+
+void Inliner::InlineCall(uint caller, uint block, uint index) {
+	FuncIR& func_ir = func_list[caller];
+	vector<IRBlock>& block_list = func_ir.block_list;
+	const IRInstr call = std::move(block_list[block].instr_list[index]);
+	const FuncIR& callee = func_list[call.func_index - library_func_number];
+
+	// the block is split after the call, and followed by blocks of the callee
+	const uint rest = (uint)block_list.size(), block_offset = rest + 1;
+	block_list.resize(block_offset + callee.block_list.size());
+	IRBlock& ir_block = block_list[block];
+	block_list[rest] = ir_block;
+	block_list[rest].instr_list.erase(block_list[rest].instr_list.begin(), block_list[rest].instr_list.begin() + index + 1);
+	ir_block.instr_list.resize(index);
+
+	// local slots of the callee for memory operands are kept after the caller's, except for its parameters
+	const uint memory_offset = func_ir.memory_length - callee.parameter_count;
+	func_ir.memory_length += callee.memory_length - callee.parameter_count;
+	for (auto [array_index, length] : callee.local_array_list) { func_ir.local_array_list.push_back({ array_index + memory_offset, length }); }
+	vector<uint> reg_map(callee.GetRegCount(), -1);
+	auto Remap = [&](IROperand& operand) {
+		if (operand.IsReg()) {
+			uint& reg = reg_map[operand.GetReg()];
+			if (reg == -1) { reg = func_ir.AllocateReg(callee.reg_is_pointer[operand.GetReg()]); }
+			operand = IROperand::Reg(reg);
+		} else if (operand.type == IROperandType::Local) {
+			operand.value += memory_offset;
+		}
+	};
+
+	for (uint i = 0; i < callee.parameter_count; ++i) {
+		IROperand parameter = IROperand::Reg(callee.parameter_reg[i]);
+		const IROperand& argument = call.argument_list[i];
+		bool is_pointer_argument = argument.IsReg() && func_ir.reg_is_pointer[argument.GetReg()];
+		if (callee.reg_is_pointer[parameter.GetReg()] != is_pointer_argument) { continue; }  // an array parameter not used
+		Remap(parameter);
+		ir_block.instr_list.push_back(IRInstr::Copy(parameter, argument));
+	}
+	ir_block.SetGoto(block_offset);
+
+	for (uint i = 0; i < callee.block_list.size(); ++i) {
+		IRBlock& ir_inlined = block_list[block_offset + i];
+		ir_inlined = callee.block_list[i];
+		for (IRInstr& instr : ir_inlined.instr_list) {
+			instr.ForEachSrc(Remap);
+			if (instr.HasDest()) { Remap(instr.GetDest()); }
+		}
+		ir_inlined.ForEachExitSrc(Remap);
+		if (ir_inlined.target != -1) { ir_inlined.target += block_offset; }
+		if (ir_inlined.next != -1) { ir_inlined.next += block_offset; }
+		if (ir_inlined.exit_type == IRExitType::Return) {
+			if (!call.var[0].IsEmpty() && !ir_inlined.exit_var[0].IsEmpty()) {
+				ir_inlined.instr_list.push_back(IRInstr::Copy(call.var[0], ir_inlined.exit_var[0]));
+			}
+			ir_inlined.SetGoto(rest);
+		}
+	}
+}
+
+void Inliner::InlineCallee(uint caller) {
+	FuncIR& func_ir = func_list[caller];
+	bool is_changed = false;
+	for (uint block = 0; block < func_ir.block_list.size(); ++block) {
+		const vector<IRInstr>& instr_list = func_ir.block_list[block].instr_list;
+		for (uint index = 0; index < instr_list.size(); ++index) {
+			const IRInstr& instr = instr_list[index];
+			if (instr.type != IRInstrType::Call || IsLibraryFunc(instr.func_index) || !IsInlinable(caller, instr)) { continue; }
+			uint callee = instr.func_index - library_func_number;
+			InlineCall(caller, block, index);
+			call_count[callee]--;
+			ForEachCallee(func_list[callee], [&](uint inner_callee) { call_count[inner_callee]++; });
+			size[caller] += size[callee];
+			is_changed = true;
+			break;  // the rest of the block is moved to a new block
+		}
+	}
+	if (is_changed) { func_ir.UpdatePredecessor(); }
+}
+
+} // namespace
+
+
+void InlineFunc(vector<FuncIR>& func_list) {
+	Inliner(func_list).Run();
+}
\ No newline at end of file
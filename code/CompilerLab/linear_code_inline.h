@@ -0,0 +1,9 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Inlines calls between FuncIRs of all functions not in SSA form, indexed by function index without library functions.
+//   Callees are inlined before their callers, with their registers, local arrays and blocks remapped into the caller.
+//   A call is inlined if the callee is not recursive, and is either small for the call overhead saved, or called once.
+void InlineFunc(vector<FuncIR>& func_list);
\ No newline at end of file
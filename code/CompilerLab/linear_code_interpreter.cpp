@@ -0,0 +1,1177 @@
+#include "linear_code_interpreter.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+
+inline OperatorType GetMirroredComparisonOperator(OperatorType op) {
+	switch (op) {
+	case OperatorType::Less: return OperatorType::Greater;
+	case OperatorType::Greater: return OperatorType::Less;
+	case OperatorType::LessEqual: return OperatorType::GreaterEuqal;
+	case OperatorType::GreaterEuqal: return OperatorType::LessEqual;
+	default: return op;
+	}
+}
+
+
+void LinearCodeInterpreter::DecodeBinaryOp(const CodeLine& line) {
+	VarInfo dest(line, 0), src1(line, 1), src2(line, 2);
+	uint form;
+	if (src1.type == VarType::Local && src2.type == VarType::Local) {
+		form = 0;
+	} else if (src1.type == VarType::Local && src2.type == VarType::Number) {
+		form = 1;
+	} else if (src1.type == VarType::Number && src2.type == VarType::Local) {
+		form = 2;
+	} else {
+		return AppendGenericInstruction(Opcode::BinaryOp, line);
+	}
+	if (dest.type != VarType::Local) { return AppendGenericInstruction(Opcode::BinaryOp, line); }
+	Opcode opcode;
+	switch (line.op) {
+#define INTERPRETER_BINARY_OPCODE(name, op) case OperatorType::name: opcode = Opcode::name##_LLL; break;
+		INTERPRETER_BINARY_OPERATOR_LIST(INTERPRETER_BINARY_OPCODE)
+#undef INTERPRETER_BINARY_OPCODE
+	default: return AppendGenericInstruction(Opcode::BinaryOp, line);
+	}
+	AppendInstruction((Opcode)((uchar)opcode + form), dest.value, src1.value, src2.value);
+}
+
+void LinearCodeInterpreter::DecodeUnaryOp(const CodeLine& line) {
+	VarInfo dest(line, 0), src(line, 1);
+	switch (line.op) {
+	case OperatorType::Add: return DecodeMove(dest, 0, src, line, Opcode::UnaryOp);
+	case OperatorType::Sub:
+		if (dest.type == VarType::Local && src.type == VarType::Local) { return AppendInstruction(Opcode::Neg_LL, dest.value, src.value); }
+		break;
+	case OperatorType::Not:
+		if (dest.type == VarType::Local && src.type == VarType::Local) { return AppendInstruction(Opcode::Not_LL, dest.value, src.value); }
+		break;
+	default: assert(false); break;
+	}
+	AppendGenericInstruction(Opcode::UnaryOp, line);
+}
+
+void LinearCodeInterpreter::DecodeAddr(const CodeLine& line) {
+	VarInfo dest(line, 0), base(line, 1), offset(line, 2);
+	assert(dest.type == VarType::Addr);
+	if (offset.type == VarType::Number) {
+		switch (base.type) {
+		case VarType::Local: return AppendInstruction(Opcode::AddrLocal_N, dest.value, base.value + offset.value);
+		case VarType::Global: return AppendInstruction(Opcode::Move_LN, dest.value, base.value + offset.value);
+		case VarType::Addr: return AppendInstruction(Opcode::AddrAddr_N, dest.value, base.value, offset.value);
+		default: assert(false); break;
+		}
+	} else if (offset.type == VarType::Local) {
+		switch (base.type) {
+		case VarType::Local: return AppendInstruction(Opcode::AddrLocal_L, dest.value, base.value, offset.value);
+		case VarType::Global: return AppendInstruction(Opcode::AddrGlobal_L, dest.value, base.value, offset.value);
+		case VarType::Addr: return AppendInstruction(Opcode::AddrAddr_L, dest.value, base.value, offset.value);
+		default: assert(false); break;
+		}
+	}
+	AppendGenericInstruction(Opcode::Addr, line);
+}
+
+void LinearCodeInterpreter::DecodeLoad(const CodeLine& line) {
+	VarInfo dest(line, 0), base(line, 1), offset(line, 2);
+	if (offset.type == VarType::Number && offset.value == 0 && base.IsRef()) { return DecodeMove(dest, 0, base, line, Opcode::Load); }
+	if (dest.type == VarType::Local) {
+		if (base.type == VarType::Addr && offset.type == VarType::Number) {
+			return AppendInstruction(Opcode::Load_LAN, dest.value, base.value, offset.value);
+		}
+		if (offset.type == VarType::Local) {
+			switch (base.type) {
+			case VarType::Addr: return AppendInstruction(Opcode::Load_LAL, dest.value, base.value, offset.value);
+			case VarType::Local: return AppendInstruction(Opcode::Load_LLL, dest.value, base.value, offset.value);
+			case VarType::Global: return AppendInstruction(Opcode::Load_LGL, dest.value, base.value, offset.value);
+			default: assert(false); break;
+			}
+		}
+	}
+	AppendGenericInstruction(Opcode::Load, line);
+}
+
+void LinearCodeInterpreter::DecodeStore(const CodeLine& line) {
+	VarInfo base(line, 0), offset(line, 1), src(line, 2);
+	if (offset.type == VarType::Number && base.IsRef()) { return DecodeMove(base, offset.value, src, line, Opcode::Store); }
+	if (src.type == VarType::Local || src.type == VarType::Number) {
+		bool is_src_local = src.type == VarType::Local;
+		if (base.type == VarType::Addr && offset.type == VarType::Number) {
+			return AppendInstruction(is_src_local ? Opcode::Store_ANL : Opcode::Store_ANN, base.value, offset.value, src.value);
+		}
+		if (offset.type == VarType::Local) {
+			switch (base.type) {
+			case VarType::Addr: return AppendInstruction(is_src_local ? Opcode::Store_ALL : Opcode::Store_ALN, base.value, offset.value, src.value);
+			case VarType::Local: return AppendInstruction(is_src_local ? Opcode::Store_LLL : Opcode::Store_LLN, base.value, offset.value, src.value);
+			case VarType::Global: return AppendInstruction(is_src_local ? Opcode::Store_GLL : Opcode::Store_GLN, base.value, offset.value, src.value);
+			default: assert(false); break;
+			}
+		}
+	}
+	AppendGenericInstruction(Opcode::Store, line);
+}
+
+void LinearCodeInterpreter::DecodeMove(VarInfo dest, int dest_offset, VarInfo src, const CodeLine& line, Opcode generic_opcode) {
+	int dest_index = dest.value + dest_offset;
+	if (dest.type == VarType::Local) {
+		switch (src.type) {
+		case VarType::Local: return AppendInstruction(Opcode::Move_LL, dest_index, src.value);
+		case VarType::Number: return AppendInstruction(Opcode::Move_LN, dest_index, src.value);
+		case VarType::Global: return AppendInstruction(Opcode::Move_LG, dest_index, src.value);
+		default: break;
+		}
+	} else if (dest.type == VarType::Global) {
+		switch (src.type) {
+		case VarType::Local: return AppendInstruction(Opcode::Move_GL, dest_index, src.value);
+		case VarType::Number: return AppendInstruction(Opcode::Move_GN, dest_index, src.value);
+		default: break;
+		}
+	}
+	AppendGenericInstruction(generic_opcode, line);
+}
+
+// Library functions are bound to their typed entries, with the arguments in the instruction.
+void LinearCodeInterpreter::DecodeLibraryFuncCall(const CodeBlock& code_block, uint& line_no) {
+	uint func_index = code_block[line_no].var[0];
+	auto ReadParameter = [&]() {
+		line_no++;
+		assert(line_no < code_block.size() && code_block[line_no].type == CodeLineType::Parameter);
+		return VarInfo(code_block[line_no], 0);
+	};
+	auto ReadArrayParameter = [&]() {
+		VarInfo para = ReadParameter();
+		assert(para.type == VarType::Addr);
+		return para.value;
+	};
+	auto AppendValueInstruction = [&](Opcode opcode_L, Opcode opcode_N, Opcode opcode_G) {
+		VarInfo para = ReadParameter();
+		switch (para.type) {
+		case VarType::Local: return AppendInstruction(opcode_L, para.value);
+		case VarType::Number: return AppendInstruction(opcode_N, para.value);
+		case VarType::Global: return AppendInstruction(opcode_G, para.value);
+		default: assert(false); return;
+		}
+	};
+	auto AppendOperandInstruction = [&](Opcode opcode) {
+		VarInfo para = ReadParameter();
+		assert(para.IsIntOrRef());
+		AppendInstruction(opcode, (int)para.type, para.value);
+	};
+	switch ((LibraryFunc)func_index) {
+	case LibraryFunc::GetInt: return AppendInstruction(Opcode::GetInt);
+	case LibraryFunc::GetCh: return AppendInstruction(Opcode::GetCh);
+	case LibraryFunc::GetArray: return AppendInstruction(Opcode::GetArray, ReadArrayParameter());
+	case LibraryFunc::PutInt: return AppendValueInstruction(Opcode::PutInt_L, Opcode::PutInt_N, Opcode::PutInt_G);
+	case LibraryFunc::PutCh: return AppendValueInstruction(Opcode::PutCh_L, Opcode::PutCh_N, Opcode::PutCh_G);
+	case LibraryFunc::PutArray: {
+		VarInfo n = ReadParameter();
+		assert(n.IsIntOrRef());
+		return AppendInstruction(Opcode::PutArray, (int)n.type, n.value, ReadArrayParameter());
+	}
+	case LibraryFunc::StartTime: return AppendOperandInstruction(Opcode::StartTime);
+	case LibraryFunc::StopTime: return AppendOperandInstruction(Opcode::StopTime);
+	default: assert(false); return;
+	}
+}
+
+void LinearCodeInterpreter::DecodeFuncCall(const CodeBlock& code_block, uint& line_no) {
+	const CodeLine& line = code_block[line_no];
+	uint func_index = line.var[0];
+	if (IsLibraryFunc(func_index)) {
+		DecodeLibraryFuncCall(code_block, line_no);
+	} else {
+		uint parameter_count = (*global_func)[func_index - library_func_number].parameter_count;
+		AppendInstruction(Opcode::Call, func_index - library_func_number);
+		for (uint i = 0; i < parameter_count; ++i) {
+			line_no++;
+			assert(line_no < code_block.size() && code_block[line_no].type == CodeLineType::Parameter);
+			VarInfo para(code_block[line_no], 0);
+			assert(para.IsIntOrRef() || para.IsAddr());
+			AppendInstruction(Opcode::Operand, (int)(para.type == VarType::Addr ? VarType::Local : para.type), para.value);
+		}
+	}
+	VarInfo dest(line, 1);
+	switch (dest.type) {
+	case VarType::Empty: break;
+	case VarType::Local: AppendInstruction(Opcode::Result_L, dest.value); break;
+	case VarType::Global: AppendInstruction(Opcode::Result_G, dest.value); break;
+	default: assert(false); break;
+	}
+}
+
+void LinearCodeInterpreter::DecodeJumpIf(const CodeLine& line, uint target) {
+	VarInfo src1(line, 1), src2(line, 2);
+	OperatorType op = line.op;
+	if (src1.type == VarType::Number && src2.type == VarType::Local) {
+		return AppendJumpIf(target, GetMirroredComparisonOperator(op), src2, src1, line);
+	}
+	AppendJumpIf(target, op, src1, src2, line);
+}
+
+void LinearCodeInterpreter::AppendJumpIf(uint target, OperatorType op, VarInfo src1, VarInfo src2, const CodeLine& line) {
+	if (src1.type == VarType::Local && (src2.type == VarType::Local || src2.type == VarType::Number)) {
+		uint form = src2.type == VarType::Local ? 0 : 1;
+		Opcode opcode;
+		switch (op) {
+#define INTERPRETER_JUMP_OPCODE(name, op) case OperatorType::name: opcode = Opcode::Jump##name##_LL; break;
+			INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_JUMP_OPCODE)
+#undef INTERPRETER_JUMP_OPCODE
+		default: assert(false); return AppendGenericInstruction(Opcode::JumpIf, line, target);
+		}
+		return AppendInstruction((Opcode)((uchar)opcode + form), target, src1.value, src2.value);
+	}
+	AppendGenericInstruction(Opcode::JumpIf, line, target);
+}
+
+// v = &base[t] followed by x = v[0], where v and t share the slot, as emitted for an array subscript
+bool LinearCodeInterpreter::DecodeAddrLoad(const CodeLine& addr_line, const CodeLine& load_line) {
+	VarInfo addr(addr_line, 0), base(addr_line, 1), offset(addr_line, 2);
+	VarInfo dest(load_line, 0), load_base(load_line, 1), load_offset(load_line, 2);
+	if (offset.type != VarType::Local || offset.value != addr.value) { return false; }
+	if (load_base.type != VarType::Addr || load_base.value != addr.value) { return false; }
+	if (load_offset.type != VarType::Number || load_offset.value != 0 || dest.type != VarType::Local) { return false; }
+	switch (base.type) {
+	case VarType::Local: AppendInstruction(Opcode::LoadIndexed_L, dest.value, base.value, offset.value); return true;
+	case VarType::Global: AppendInstruction(Opcode::LoadIndexed_G, dest.value, base.value, offset.value); return true;
+	case VarType::Addr: AppendInstruction(Opcode::LoadIndexed_A, dest.value, base.value, offset.value); return true;
+	default: assert(false); return false;
+	}
+}
+
+// v = &base[t] followed by v[0] = x
+bool LinearCodeInterpreter::DecodeAddrStore(const CodeLine& addr_line, const CodeLine& store_line) {
+	VarInfo addr(addr_line, 0), base(addr_line, 1), offset(addr_line, 2);
+	VarInfo store_base(store_line, 0), store_offset(store_line, 1), src(store_line, 2);
+	if (offset.type != VarType::Local || offset.value != addr.value) { return false; }
+	if (store_base.type != VarType::Addr || store_base.value != addr.value) { return false; }
+	if (store_offset.type != VarType::Number || store_offset.value != 0) { return false; }
+	if (src.type != VarType::Local && src.type != VarType::Number) { return false; }
+	uint form = src.type == VarType::Local ? 0 : 1;
+	Opcode opcode;
+	switch (base.type) {
+	case VarType::Local: opcode = Opcode::StoreIndexed_LL; break;
+	case VarType::Global: opcode = Opcode::StoreIndexed_GL; break;
+	case VarType::Addr: opcode = Opcode::StoreIndexed_AL; break;
+	default: assert(false); return false;
+	}
+	AppendInstruction((Opcode)((uchar)opcode + form), offset.value, base.value, src.value);
+	return true;
+}
+
+// t = x op y followed by the assignment v = t
+bool LinearCodeInterpreter::DecodeBinaryOpMove(const CodeLine& line, const CodeLine& store_line) {
+	VarInfo dest(line, 0), src1(line, 1), src2(line, 2);
+	VarInfo store_base(store_line, 0), store_offset(store_line, 1), store_src(store_line, 2);
+	if (dest.type != VarType::Local || store_src.type != VarType::Local || store_src.value != dest.value) { return false; }
+	if (store_base.type != VarType::Local || store_offset.type != VarType::Number) { return false; }
+	uint form;
+	if (src1.type == VarType::Local && src2.type == VarType::Local) {
+		form = 0;
+	} else if (src1.type == VarType::Local && src2.type == VarType::Number) {
+		form = 1;
+	} else if (src1.type == VarType::Number && src2.type == VarType::Local) {
+		form = 2;
+	} else {
+		return false;
+	}
+	Opcode opcode;
+	switch (line.op) {
+#define INTERPRETER_MOVE_OPCODE(name, op) case OperatorType::name: opcode = Opcode::name##Move_LLL; break;
+		INTERPRETER_ARITHMETIC_OPERATOR_LIST(INTERPRETER_MOVE_OPCODE)
+#undef INTERPRETER_MOVE_OPCODE
+	default: return false;
+	}
+	AppendInstruction((Opcode)((uchar)opcode + form), dest.value, src1.value, src2.value);
+	AppendInstruction(Opcode::Operand, store_base.value + store_offset.value);
+	return true;
+}
+
+// t = x op y followed by goto label if t == 0 (or t != 0), the target is resolved into the Operand instruction
+bool LinearCodeInterpreter::DecodeCompareJumpIf(const CodeLine& line, const CodeLine& jump_line) {
+	VarInfo dest(line, 0), src1(line, 1), src2(line, 2);
+	VarInfo jump_src1(jump_line, 1), jump_src2(jump_line, 2);
+	if (dest.type != VarType::Local || jump_src1.type != VarType::Local || jump_src1.value != dest.value) { return false; }
+	if (jump_src2.type != VarType::Number || jump_src2.value != 0) { return false; }
+	if (jump_line.op != OperatorType::Equal && jump_line.op != OperatorType::NotEqual) { return false; }
+	bool is_mirrored = src1.type == VarType::Number && src2.type == VarType::Local;
+	VarInfo left = is_mirrored ? src2 : src1, right = is_mirrored ? src1 : src2;
+	if (left.type != VarType::Local || (right.type != VarType::Local && right.type != VarType::Number)) { return false; }
+	uint form = right.type == VarType::Local ? 0 : 1;
+	Opcode opcode;
+	switch (is_mirrored ? GetMirroredComparisonOperator(line.op) : line.op) {
+#define INTERPRETER_COMPARE_JUMP_OPCODE(name, op) case OperatorType::name: opcode = Opcode::CompareJump##name##_LL; break;
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_COMPARE_JUMP_OPCODE)
+#undef INTERPRETER_COMPARE_JUMP_OPCODE
+	default: return false;
+	}
+	AppendInstruction((Opcode)((uchar)opcode + form), dest.value, left.value, right.value);
+	AppendInstruction(Opcode::Operand, 0, jump_line.op == OperatorType::Equal ? 1 : 0);  // the comparison yields 0 or 1
+	return true;
+}
+
+bool LinearCodeInterpreter::DecodeSuperinstruction(const CodeBlock& code_block, uint& line_no, const vector<bool>& is_jump_target,
+												   vector<std::pair<uint, uint>>& jump_list) {
+	if (line_no + 1 >= code_block.size() || is_jump_target[line_no + 1]) { return false; }
+	const CodeLine& line = code_block[line_no]; const CodeLine& next_line = code_block[line_no + 1];
+	bool is_fused = false;
+	switch (line.type) {
+	case CodeLineType::Addr:
+		if (next_line.type == CodeLineType::Load) { is_fused = DecodeAddrLoad(line, next_line); }
+		if (next_line.type == CodeLineType::Store) { is_fused = DecodeAddrStore(line, next_line); }
+		break;
+	case CodeLineType::BinaryOp:
+		if (next_line.type == CodeLineType::Store) { is_fused = DecodeBinaryOpMove(line, next_line); }
+		if (next_line.type == CodeLineType::JumpIf) {
+			is_fused = DecodeCompareJumpIf(line, next_line);
+			if (is_fused) { jump_list.push_back({ (uint)code.size() - 1, next_line.var[0] }); }
+		}
+		break;
+	default: break;
+	}
+	if (is_fused) { line_no++; }
+	return is_fused;
+}
+
+void LinearCodeInterpreter::DecodeReturn(const CodeLine& line) {
+	VarInfo var(line, 0);
+	if (profiler != nullptr) { AppendInstruction(Opcode::ProfileLeave); }
+	switch (var.type) {
+	case VarType::Empty: return AppendInstruction(Opcode::Return_V);
+	case VarType::Local: return AppendInstruction(Opcode::Return_L, var.value);
+	case VarType::Number: return AppendInstruction(Opcode::Return_N, var.value);
+	case VarType::Global: return AppendInstruction(Opcode::Return_G, var.value);
+	default: assert(false); return;
+	}
+}
+
+void LinearCodeInterpreter::DecodeFuncDef(const GlobalFuncDef& func_def) {
+	const CodeBlock& code_block = func_def.code_block;
+	uint func_index = (uint)func_record_table.size();
+	uint entry = (uint)code.size();
+	if (profiler != nullptr) { AppendInstruction(Opcode::ProfileEnter, func_index); }
+	vector<uint> line_pc(code_block.size() + 1);  // the instruction index of each line
+	vector<std::pair<uint, uint>> jump_list;  // (instruction index, label index), resolved after the whole function is decoded
+	vector<bool> is_jump_target(code_block.size() + 1);  // lines starting with a jump target can't be fused into the line before
+	for (uint line_no : func_def.label_map) { is_jump_target[line_no] = true; }
+	for (uint line_no = 0; line_no < code_block.size(); ++line_no) {
+		line_pc[line_no] = (uint)code.size();
+		if (profiler != nullptr) {
+			AppendInstruction(Opcode::ProfileLine, profiler->GetLineCounter(func_index, line_no));
+		} else if (DecodeSuperinstruction(code_block, line_no, is_jump_target, jump_list)) {
+			continue;
+		}
+		const CodeLine& line = code_block[line_no];
+		switch (line.type) {
+		case CodeLineType::BinaryOp: DecodeBinaryOp(line); break;
+		case CodeLineType::UnaryOp: DecodeUnaryOp(line); break;
+		case CodeLineType::Addr: DecodeAddr(line); break;
+		case CodeLineType::Load: DecodeLoad(line); break;
+		case CodeLineType::Store: DecodeStore(line); break;
+		case CodeLineType::FuncCall: DecodeFuncCall(code_block, line_no); break;
+		case CodeLineType::JumpIf:
+			jump_list.push_back({ (uint)code.size(), line.var[0] });
+			DecodeJumpIf(line, 0);
+			if (profiler != nullptr) { AppendInstruction(Opcode::ProfileFallThrough, profiler->GetLineCounter(func_index, line_no)); }
+			break;
+		case CodeLineType::Goto:
+			jump_list.push_back({ (uint)code.size(), line.var[0] });
+			AppendInstruction(Opcode::Goto, 0);
+			break;
+		case CodeLineType::Return: DecodeReturn(line); break;
+		case CodeLineType::Fill: AppendGenericInstruction(Opcode::Fill, line); break;
+		case CodeLineType::MemCopy: AppendGenericInstruction(Opcode::MemCopy, line); break;
+		default: assert(false); break;
+		}
+	}
+	line_pc[code_block.size()] = (uint)code.size();
+	if (profiler != nullptr) { AppendInstruction(Opcode::ProfileLeave); }
+	AppendInstruction(Opcode::Return_V);
+	for (auto [pc, label_index] : jump_list) {
+		assert(label_index < func_def.label_map.size() && func_def.label_map[label_index] <= code_block.size());
+		uint target = line_pc[func_def.label_map[label_index]];
+		Instruction& instruction = code[pc];
+		if (instruction.opcode == Opcode::JumpIf) {
+			generic_line_table[instruction.a].target = target;
+		} else {
+			instruction.a = (int)target;
+		}
+	}
+	func_record_table.push_back(FuncRecord{ entry, func_def.local_var_length, func_def.parameter_count });
+#ifdef LINEAR_CODE_JIT
+	vector<uint>& label_pc = label_pc_table.emplace_back();
+	for (uint line_no : func_def.label_map) { label_pc.push_back(line_pc[line_no]); }
+#endif
+}
+
+void LinearCodeInterpreter::DecodeFuncTable(const GlobalFuncTable& global_func_table) {
+	code.clear(); generic_line_table.clear(); func_record_table.clear();
+	threaded_handler_table = nullptr;
+#ifdef LINEAR_CODE_JIT
+	label_pc_table.clear();
+#endif
+	for (auto& func_def : global_func_table) {
+		assert(func_def.parameter_count <= func_def.local_var_length);
+		DecodeFuncDef(func_def);
+	}
+}
+
+bool LinearCodeInterpreter::VerifyFuncDef(const GlobalFuncDef& func_def, uint global_var_length) {
+	auto IsInBounds = [&](VarInfo var, int offset) {
+		uint64 index = (uint64)(uint)var.value + (uint64)(uint)offset;
+		switch (var.type) {
+		case VarType::Local: case VarType::Addr: return index < func_def.local_var_length;
+		case VarType::Global: return index < global_var_length;
+		default: return true;
+		}
+	};
+	for (auto& line : func_def.code_block) {
+		for (int i = 0; i < 3; ++i) {
+			if (!IsInBounds(VarInfo(line, i), 0)) { return false; }
+		}
+		// an element of an array with constant subscript is accessed directly
+		if (line.type == CodeLineType::Load && line.var_type[1].IsRef() && line.var_type[2] == VarType::Number) {
+			if (!IsInBounds(VarInfo(line, 1), line.var[2])) { return false; }
+		}
+		if (line.type == CodeLineType::Store && line.var_type[0].IsRef() && line.var_type[1] == VarType::Number) {
+			if (!IsInBounds(VarInfo(line, 0), line.var[1])) { return false; }
+		}
+		// so are the ranges of bulk operations on arrays
+		if ((line.type == CodeLineType::Fill || line.type == CodeLineType::MemCopy) && line.var[1] > 0) {
+			if (!IsInBounds(VarInfo(line, 0), line.var[1] - 1)) { return false; }
+			if (line.type == CodeLineType::MemCopy && !IsInBounds(VarInfo(line, 2), line.var[1] - 1)) { return false; }
+		}
+	}
+	return true;
+}
+
+bool LinearCodeInterpreter::VerifyFuncTable(const GlobalFuncTable& global_func_table, uint global_var_length) {
+	for (auto& func_def : global_func_table) {
+		if (!VerifyFuncDef(func_def, global_var_length)) { return false; }
+	}
+	return true;
+}
+
+void LinearCodeInterpreter::ThreadCode(const Handler handler_table[(uchar)Opcode::_Count]) {
+	for (auto& instruction : code) { instruction.handler = handler_table[(uchar)instruction.opcode]; }
+}
+
+
+void LinearCodeInterpreter::GrowStack(uint new_stack_top) {
+	assert(new_stack_top > var_stack.size());
+	uint64 new_stack_size = ((uint64)new_stack_top + stack_segment_size - 1) / stack_segment_size * stack_segment_size;
+	var_stack.resize((size_t)std::min(new_stack_size, (uint64)std::max(option.max_stack_size, new_stack_top)));
+}
+
+// Returns the new frame above the current one, whose parameters are to be filled by the caller.
+int* LinearCodeInterpreter::AllocateFrame(const FuncRecord& func_record) {
+	assert(frame_pointer + current_func_frame_size == stack_top);
+	uint new_stack_top = stack_top + func_record.frame_size;
+	if (new_stack_top > option.max_stack_size || new_stack_top < stack_top || call_stack.size() > option.max_stack_size) {
+		throw std::runtime_error("stack overflow");
+	}
+	if (new_stack_top > var_stack.size()) { GrowStack(new_stack_top); }
+	int* frame = var_stack.data() + stack_top;
+	if (option.poison_local_var) {
+		std::fill(frame + func_record.parameter_count, frame + func_record.frame_size, local_var_initial_value);
+	}
+	return frame;
+}
+
+void LinearCodeInterpreter::ActivateFrame(const FuncRecord& func_record) {
+	frame_pointer = stack_top;
+	current_func_frame_size = func_record.frame_size;
+	stack_top += func_record.frame_size;
+}
+
+void LinearCodeInterpreter::EnterFunc(const FuncRecord& func_record) {
+	assert(func_record.parameter_count == 0);
+	AllocateFrame(func_record);
+	ActivateFrame(func_record);
+}
+
+void LinearCodeInterpreter::LeaveFunc() {
+	stack_top = frame_pointer;
+}
+
+
+#ifdef INTERPRETER_COMPUTED_GOTO
+#define INTERPRETER_DISPATCH() goto *pc->handler
+#define INTERPRETER_SWITCH_BEGIN
+#define INTERPRETER_SWITCH_END
+#define INTERPRETER_CASE(opcode) label_##opcode:
+#define INTERPRETER_HANDLER(opcode) &&label_##opcode,
+#else
+#define INTERPRETER_DISPATCH() continue
+#define INTERPRETER_SWITCH_BEGIN switch (pc->handler) {
+#define INTERPRETER_SWITCH_END default: assert(false); return; }
+#define INTERPRETER_CASE(opcode) case Opcode::opcode:
+#define INTERPRETER_HANDLER(opcode) Opcode::opcode,
+#endif
+
+#define INTERPRETER_NEXT() ++pc; INTERPRETER_DISPATCH()
+#define INTERPRETER_JUMP(target) pc = code.data() + (target); INTERPRETER_DISPATCH()
+
+// a jump within the function, where backward jumps count towards compiling the function
+#ifdef LINEAR_CODE_JIT
+#define INTERPRETER_BRANCH(target) { \
+	const Instruction* target_pc = code.data() + (target); \
+	if constexpr (mode != ExecutionMode::Checked) { \
+		if (target_pc <= pc && --jit_back_edge_countdown < 0 && ExecuteJitFuncFromBackEdge(target_pc)) { goto leave_func; } \
+	} \
+	pc = target_pc; INTERPRETER_DISPATCH(); \
+}
+#else
+#define INTERPRETER_BRANCH(target) INTERPRETER_JUMP(target)
+#endif
+
+
+template<LinearCodeInterpreter::ExecutionMode mode>
+void LinearCodeInterpreter::ExecuteFunc(uint func_index) {
+	static const Handler handler_table[(uchar)Opcode::_Count] = {
+		INTERPRETER_HANDLER(BinaryOp) INTERPRETER_HANDLER(UnaryOp) INTERPRETER_HANDLER(Addr)
+		INTERPRETER_HANDLER(Load) INTERPRETER_HANDLER(Store) INTERPRETER_HANDLER(JumpIf)
+		INTERPRETER_HANDLER(Fill) INTERPRETER_HANDLER(MemCopy)
+#define INTERPRETER_BINARY_OPCODE(name, op) INTERPRETER_HANDLER(name##_LLL) INTERPRETER_HANDLER(name##_LLN) INTERPRETER_HANDLER(name##_LNL)
+		INTERPRETER_BINARY_OPERATOR_LIST(INTERPRETER_BINARY_OPCODE)
+#undef INTERPRETER_BINARY_OPCODE
+		INTERPRETER_HANDLER(Neg_LL) INTERPRETER_HANDLER(Not_LL)
+		INTERPRETER_HANDLER(Move_LL) INTERPRETER_HANDLER(Move_LN) INTERPRETER_HANDLER(Move_LG)
+		INTERPRETER_HANDLER(Move_GL) INTERPRETER_HANDLER(Move_GN)
+		INTERPRETER_HANDLER(AddrLocal_N) INTERPRETER_HANDLER(AddrLocal_L) INTERPRETER_HANDLER(AddrGlobal_L)
+		INTERPRETER_HANDLER(AddrAddr_N) INTERPRETER_HANDLER(AddrAddr_L)
+		INTERPRETER_HANDLER(Load_LAN) INTERPRETER_HANDLER(Load_LAL) INTERPRETER_HANDLER(Load_LLL) INTERPRETER_HANDLER(Load_LGL)
+		INTERPRETER_HANDLER(Store_ANL) INTERPRETER_HANDLER(Store_ANN) INTERPRETER_HANDLER(Store_ALL) INTERPRETER_HANDLER(Store_ALN)
+		INTERPRETER_HANDLER(Store_LLL) INTERPRETER_HANDLER(Store_LLN) INTERPRETER_HANDLER(Store_GLL) INTERPRETER_HANDLER(Store_GLN)
+		INTERPRETER_HANDLER(LoadIndexed_L) INTERPRETER_HANDLER(LoadIndexed_G) INTERPRETER_HANDLER(LoadIndexed_A)
+		INTERPRETER_HANDLER(StoreIndexed_LL) INTERPRETER_HANDLER(StoreIndexed_LN) INTERPRETER_HANDLER(StoreIndexed_GL)
+		INTERPRETER_HANDLER(StoreIndexed_GN) INTERPRETER_HANDLER(StoreIndexed_AL) INTERPRETER_HANDLER(StoreIndexed_AN)
+#define INTERPRETER_MOVE_OPCODE(name, op) INTERPRETER_HANDLER(name##Move_LLL) INTERPRETER_HANDLER(name##Move_LLN) INTERPRETER_HANDLER(name##Move_LNL)
+		INTERPRETER_ARITHMETIC_OPERATOR_LIST(INTERPRETER_MOVE_OPCODE)
+#undef INTERPRETER_MOVE_OPCODE
+#define INTERPRETER_JUMP_OPCODE(name, op) INTERPRETER_HANDLER(Jump##name##_LL) INTERPRETER_HANDLER(Jump##name##_LN)
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_JUMP_OPCODE)
+#undef INTERPRETER_JUMP_OPCODE
+#define INTERPRETER_COMPARE_JUMP_OPCODE(name, op) INTERPRETER_HANDLER(CompareJump##name##_LL) INTERPRETER_HANDLER(CompareJump##name##_LN)
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_COMPARE_JUMP_OPCODE)
+#undef INTERPRETER_COMPARE_JUMP_OPCODE
+		INTERPRETER_HANDLER(Goto)
+		INTERPRETER_HANDLER(Call)
+		INTERPRETER_HANDLER(GetInt) INTERPRETER_HANDLER(GetCh) INTERPRETER_HANDLER(GetArray)
+		INTERPRETER_HANDLER(PutInt_L) INTERPRETER_HANDLER(PutInt_N) INTERPRETER_HANDLER(PutInt_G)
+		INTERPRETER_HANDLER(PutCh_L) INTERPRETER_HANDLER(PutCh_N) INTERPRETER_HANDLER(PutCh_G)
+		INTERPRETER_HANDLER(PutArray) INTERPRETER_HANDLER(StartTime) INTERPRETER_HANDLER(StopTime)
+		INTERPRETER_HANDLER(Result_L) INTERPRETER_HANDLER(Result_G)
+		INTERPRETER_HANDLER(Return_V) INTERPRETER_HANDLER(Return_L) INTERPRETER_HANDLER(Return_N) INTERPRETER_HANDLER(Return_G)
+		INTERPRETER_HANDLER(ProfileLine) INTERPRETER_HANDLER(ProfileFallThrough) INTERPRETER_HANDLER(ProfileEnter) INTERPRETER_HANDLER(ProfileLeave)
+		INTERPRETER_HANDLER(Operand)
+	};
+	if (threaded_handler_table != handler_table) { ThreadCode(handler_table); threaded_handler_table = handler_table; }
+
+	constexpr ExecutionMode indirect_mode = GetIndirectAccessMode(mode);
+	const size_t call_stack_depth = call_stack.size();
+	const Instruction* pc = code.data() + func_record_table[func_index].entry;
+
+#ifdef INTERPRETER_COMPUTED_GOTO
+	INTERPRETER_DISPATCH();
+#endif
+	for (;;) {
+		INTERPRETER_SWITCH_BEGIN
+
+		INTERPRETER_CASE(BinaryOp) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			SetVarValue(VarInfo(line, 0), EvalBinaryOperator(line.op, GetVarValue(VarInfo(line, 1)), GetVarValue(VarInfo(line, 2))));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(UnaryOp) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			SetVarValue(VarInfo(line, 0), EvalUnaryOperator(line.op, GetVarValue(VarInfo(line, 1))));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Addr) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			SetAddr(VarInfo(line, 0), GetVarAddr(VarInfo(line, 1), GetVarValue(VarInfo(line, 2))));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Load) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			SetVarValue(VarInfo(line, 0), GetValueAtGlobalIndex(GetVarAddr(VarInfo(line, 1), GetVarValue(VarInfo(line, 2)))));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			SetValueAtGlobalIndex(GetVarAddr(VarInfo(line, 0), GetVarValue(VarInfo(line, 1))), GetVarValue(VarInfo(line, 2)));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(JumpIf) {
+			const GenericLine& generic_line = generic_line_table[pc->a];
+			const CodeLine& line = *generic_line.line;
+			if (EvalBinaryOperator(line.op, GetVarValue(VarInfo(line, 1)), GetVarValue(VarInfo(line, 2)))) {
+				INTERPRETER_BRANCH(generic_line.target);
+			}
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Fill) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			uint length = (uint)line.var[1];
+			int value = GetVarValue(VarInfo(line, 2));
+			std::fill_n(GetRange(GetVarAddr(VarInfo(line, 0), 0), length), length, value);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(MemCopy) {
+			const CodeLine& line = *generic_line_table[pc->a].line;
+			uint length = (uint)line.var[1];
+			const int* src = GetRange(GetVarAddr(VarInfo(line, 2), 0), length);
+			std::memmove(GetRange(GetVarAddr(VarInfo(line, 0), 0), length), src, (size_t)length * sizeof(int));
+			INTERPRETER_NEXT();
+		}
+
+#define INTERPRETER_BINARY_OPCODE(name, op) \
+		INTERPRETER_CASE(name##_LLL) { \
+			SetValueAtLocalIndex<mode>(pc->a, (int)(GetValueAtLocalIndex<mode>(pc->b) op GetValueAtLocalIndex<mode>(pc->c))); \
+			INTERPRETER_NEXT(); \
+		} \
+		INTERPRETER_CASE(name##_LLN) { \
+			SetValueAtLocalIndex<mode>(pc->a, (int)(GetValueAtLocalIndex<mode>(pc->b) op pc->c)); \
+			INTERPRETER_NEXT(); \
+		} \
+		INTERPRETER_CASE(name##_LNL) { \
+			SetValueAtLocalIndex<mode>(pc->a, (int)(pc->b op GetValueAtLocalIndex<mode>(pc->c))); \
+			INTERPRETER_NEXT(); \
+		}
+		INTERPRETER_BINARY_OPERATOR_LIST(INTERPRETER_BINARY_OPCODE)
+#undef INTERPRETER_BINARY_OPCODE
+
+		INTERPRETER_CASE(Neg_LL) {
+			SetValueAtLocalIndex<mode>(pc->a, -GetValueAtLocalIndex<mode>(pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Not_LL) {
+			SetValueAtLocalIndex<mode>(pc->a, (int)!GetValueAtLocalIndex<mode>(pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Move_LL) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtLocalIndex<mode>(pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Move_LN) {
+			SetValueAtLocalIndex<mode>(pc->a, pc->b);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Move_LG) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<mode>(pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Move_GL) {
+			SetValueAtGlobalIndex<mode>(pc->a, GetValueAtLocalIndex<mode>(pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Move_GN) {
+			SetValueAtGlobalIndex<mode>(pc->a, pc->b);
+			INTERPRETER_NEXT();
+		}
+
+		INTERPRETER_CASE(AddrLocal_N) {
+			SetValueAtLocalIndex<mode>(pc->a, (int)(frame_pointer + pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(AddrLocal_L) {
+			SetValueAtLocalIndex<mode>(pc->a, (int)(frame_pointer + pc->b + GetValueAtLocalIndex<mode>(pc->c)));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(AddrGlobal_L) {
+			SetValueAtLocalIndex<mode>(pc->a, pc->b + GetValueAtLocalIndex<mode>(pc->c));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(AddrAddr_N) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtLocalIndex<mode>(pc->b) + pc->c);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(AddrAddr_L) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtLocalIndex<mode>(pc->b) + GetValueAtLocalIndex<mode>(pc->c));
+			INTERPRETER_NEXT();
+		}
+
+		INTERPRETER_CASE(Load_LAN) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<indirect_mode>(GetValueAtLocalIndex<mode>(pc->b) + pc->c));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Load_LAL) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<indirect_mode>(GetValueAtLocalIndex<mode>(pc->b) + GetValueAtLocalIndex<mode>(pc->c)));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Load_LLL) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtLocalIndex<indirect_mode>(pc->b + GetValueAtLocalIndex<mode>(pc->c)));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Load_LGL) {
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<indirect_mode>(pc->b + GetValueAtLocalIndex<mode>(pc->c)));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_ANL) {
+			SetValueAtGlobalIndex<indirect_mode>(GetValueAtLocalIndex<mode>(pc->a) + pc->b, GetValueAtLocalIndex<mode>(pc->c));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_ANN) {
+			SetValueAtGlobalIndex<indirect_mode>(GetValueAtLocalIndex<mode>(pc->a) + pc->b, pc->c);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_ALL) {
+			SetValueAtGlobalIndex<indirect_mode>(GetValueAtLocalIndex<mode>(pc->a) + GetValueAtLocalIndex<mode>(pc->b), GetValueAtLocalIndex<mode>(pc->c));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_ALN) {
+			SetValueAtGlobalIndex<indirect_mode>(GetValueAtLocalIndex<mode>(pc->a) + GetValueAtLocalIndex<mode>(pc->b), pc->c);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_LLL) {
+			SetValueAtLocalIndex<indirect_mode>(pc->a + GetValueAtLocalIndex<mode>(pc->b), GetValueAtLocalIndex<mode>(pc->c));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_LLN) {
+			SetValueAtLocalIndex<indirect_mode>(pc->a + GetValueAtLocalIndex<mode>(pc->b), pc->c);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_GLL) {
+			SetValueAtGlobalIndex<indirect_mode>(pc->a + GetValueAtLocalIndex<mode>(pc->b), GetValueAtLocalIndex<mode>(pc->c));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Store_GLN) {
+			SetValueAtGlobalIndex<indirect_mode>(pc->a + GetValueAtLocalIndex<mode>(pc->b), pc->c);
+			INTERPRETER_NEXT();
+		}
+
+		INTERPRETER_CASE(LoadIndexed_L) {
+			uint addr = frame_pointer + pc->b + GetValueAtLocalIndex<mode>(pc->c);
+			SetValueAtLocalIndex<mode>(pc->c, (int)addr);
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<indirect_mode>(addr));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(LoadIndexed_G) {
+			uint addr = pc->b + GetValueAtLocalIndex<mode>(pc->c);
+			SetValueAtLocalIndex<mode>(pc->c, (int)addr);
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<indirect_mode>(addr));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(LoadIndexed_A) {
+			uint addr = GetValueAtLocalIndex<mode>(pc->b) + GetValueAtLocalIndex<mode>(pc->c);
+			SetValueAtLocalIndex<mode>(pc->c, (int)addr);
+			SetValueAtLocalIndex<mode>(pc->a, GetValueAtGlobalIndex<indirect_mode>(addr));
+			INTERPRETER_NEXT();
+		}
+#define INTERPRETER_STORE_INDEXED_OPCODE(base_form, base_addr) \
+		INTERPRETER_CASE(StoreIndexed_##base_form##L) { \
+			uint addr = (base_addr) + GetValueAtLocalIndex<mode>(pc->a); \
+			SetValueAtLocalIndex<mode>(pc->a, (int)addr); \
+			SetValueAtGlobalIndex<indirect_mode>(addr, GetValueAtLocalIndex<mode>(pc->c)); \
+			INTERPRETER_NEXT(); \
+		} \
+		INTERPRETER_CASE(StoreIndexed_##base_form##N) { \
+			uint addr = (base_addr) + GetValueAtLocalIndex<mode>(pc->a); \
+			SetValueAtLocalIndex<mode>(pc->a, (int)addr); \
+			SetValueAtGlobalIndex<indirect_mode>(addr, pc->c); \
+			INTERPRETER_NEXT(); \
+		}
+		INTERPRETER_STORE_INDEXED_OPCODE(L, frame_pointer + pc->b)
+		INTERPRETER_STORE_INDEXED_OPCODE(G, pc->b)
+		INTERPRETER_STORE_INDEXED_OPCODE(A, GetValueAtLocalIndex<mode>(pc->b))
+#undef INTERPRETER_STORE_INDEXED_OPCODE
+
+#define INTERPRETER_MOVE_OPCODE(name, op) \
+		INTERPRETER_CASE(name##Move_LLL) { \
+			int value = (int)(GetValueAtLocalIndex<mode>(pc->b) op GetValueAtLocalIndex<mode>(pc->c)); \
+			SetValueAtLocalIndex<mode>(pc->a, value); SetValueAtLocalIndex<mode>(pc[1].a, value); \
+			pc += 2; INTERPRETER_DISPATCH(); \
+		} \
+		INTERPRETER_CASE(name##Move_LLN) { \
+			int value = (int)(GetValueAtLocalIndex<mode>(pc->b) op pc->c); \
+			SetValueAtLocalIndex<mode>(pc->a, value); SetValueAtLocalIndex<mode>(pc[1].a, value); \
+			pc += 2; INTERPRETER_DISPATCH(); \
+		} \
+		INTERPRETER_CASE(name##Move_LNL) { \
+			int value = (int)(pc->b op GetValueAtLocalIndex<mode>(pc->c)); \
+			SetValueAtLocalIndex<mode>(pc->a, value); SetValueAtLocalIndex<mode>(pc[1].a, value); \
+			pc += 2; INTERPRETER_DISPATCH(); \
+		}
+		INTERPRETER_ARITHMETIC_OPERATOR_LIST(INTERPRETER_MOVE_OPCODE)
+#undef INTERPRETER_MOVE_OPCODE
+
+#define INTERPRETER_JUMP_OPCODE(name, op) \
+		INTERPRETER_CASE(Jump##name##_LL) { \
+			if (GetValueAtLocalIndex<mode>(pc->b) op GetValueAtLocalIndex<mode>(pc->c)) { INTERPRETER_BRANCH(pc->a); } \
+			INTERPRETER_NEXT(); \
+		} \
+		INTERPRETER_CASE(Jump##name##_LN) { \
+			if (GetValueAtLocalIndex<mode>(pc->b) op pc->c) { INTERPRETER_BRANCH(pc->a); } \
+			INTERPRETER_NEXT(); \
+		}
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_JUMP_OPCODE)
+#undef INTERPRETER_JUMP_OPCODE
+#define INTERPRETER_COMPARE_JUMP_OPCODE(name, op) \
+		INTERPRETER_CASE(CompareJump##name##_LL) { \
+			int value = (int)(GetValueAtLocalIndex<mode>(pc->b) op GetValueAtLocalIndex<mode>(pc->c)); \
+			SetValueAtLocalIndex<mode>(pc->a, value); \
+			if (value != pc[1].b) { INTERPRETER_BRANCH(pc[1].a); } \
+			pc += 2; INTERPRETER_DISPATCH(); \
+		} \
+		INTERPRETER_CASE(CompareJump##name##_LN) { \
+			int value = (int)(GetValueAtLocalIndex<mode>(pc->b) op pc->c); \
+			SetValueAtLocalIndex<mode>(pc->a, value); \
+			if (value != pc[1].b) { INTERPRETER_BRANCH(pc[1].a); } \
+			pc += 2; INTERPRETER_DISPATCH(); \
+		}
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_COMPARE_JUMP_OPCODE)
+#undef INTERPRETER_COMPARE_JUMP_OPCODE
+		INTERPRETER_CASE(Goto) {
+			INTERPRETER_BRANCH(pc->a);
+		}
+
+		INTERPRETER_CASE(Call) {
+			uint callee_index = pc->a;
+			const FuncRecord& func_record = func_record_table[callee_index];
+			int* frame = AllocateFrame(func_record);
+			for (uint i = 0; i < func_record.parameter_count; ++i) {
+				const Instruction& argument = *++pc;
+				frame[i] = GetOperandValue<mode>((VarType)argument.a, argument.b);
+			}
+			call_stack.push_back(CallFrame{ (uint)(pc + 1 - code.data()), frame_pointer, current_func_frame_size });
+			ActivateFrame(func_record);
+#ifdef LINEAR_CODE_JIT
+			if constexpr (mode != ExecutionMode::Checked) {
+				if (--jit_call_countdown[callee_index] < 0 && ExecuteJitFunc(callee_index)) { goto leave_func; }
+			}
+#endif
+			INTERPRETER_JUMP(func_record.entry);
+		}
+		INTERPRETER_CASE(GetInt) {
+			return_value = LibraryGetInt();
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(GetCh) {
+			return_value = LibraryGetCh();
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(GetArray) {
+			uint array_size; int* array_addr = GetArrayArgument(GetValueAtLocalIndex<mode>(pc->a), array_size);
+			return_value = LibraryGetArray(array_addr, array_size);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutInt_L) {
+			LibraryPutInt(GetValueAtLocalIndex<mode>(pc->a));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutInt_N) {
+			LibraryPutInt(pc->a);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutInt_G) {
+			LibraryPutInt(GetValueAtGlobalIndex<mode>(pc->a));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutCh_L) {
+			LibraryPutCh(GetValueAtLocalIndex<mode>(pc->a));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutCh_N) {
+			LibraryPutCh(pc->a);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutCh_G) {
+			LibraryPutCh(GetValueAtGlobalIndex<mode>(pc->a));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(PutArray) {
+			uint array_size; int* array_addr = GetArrayArgument(GetValueAtLocalIndex<mode>(pc->c), array_size);
+			LibraryPutArray(GetOperandValue<mode>((VarType)pc->a, pc->b), array_addr, array_size);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(StartTime) {
+			LibraryStartTime(GetOperandValue<mode>((VarType)pc->a, pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(StopTime) {
+			LibraryStopTime(GetOperandValue<mode>((VarType)pc->a, pc->b));
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Result_L) {
+			SetValueAtLocalIndex<mode>(pc->a, return_value);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Result_G) {
+			SetValueAtGlobalIndex<mode>(pc->a, return_value);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(Return_L) {
+			return_value = GetValueAtLocalIndex<mode>(pc->a);
+			goto leave_func;
+		}
+		INTERPRETER_CASE(Return_N) {
+			return_value = pc->a;
+			goto leave_func;
+		}
+		INTERPRETER_CASE(Return_G) {
+			return_value = GetValueAtGlobalIndex<mode>(pc->a);
+			goto leave_func;
+		}
+		INTERPRETER_CASE(Return_V) {
+		leave_func:
+			LeaveFunc();
+			if (call_stack.size() == call_stack_depth) { return; }
+			CallFrame frame = call_stack.back(); call_stack.pop_back();
+			frame_pointer = frame.frame_pointer;
+			current_func_frame_size = frame.frame_size;
+			INTERPRETER_JUMP(frame.return_pc);
+		}
+
+		INTERPRETER_CASE(ProfileLine) {
+			profiler->CountLine(pc->a);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(ProfileFallThrough) {
+			profiler->CountFallThrough(pc->a);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(ProfileEnter) {
+			profiler->EnterFunc(pc->a);
+			INTERPRETER_NEXT();
+		}
+		INTERPRETER_CASE(ProfileLeave) {
+			profiler->LeaveFunc();
+			INTERPRETER_NEXT();
+		}
+
+		INTERPRETER_CASE(Operand) {
+			assert(false);
+			INTERPRETER_NEXT();
+		}
+
+		INTERPRETER_SWITCH_END
+	}
+}
+
+#undef INTERPRETER_DISPATCH
+#undef INTERPRETER_SWITCH_BEGIN
+#undef INTERPRETER_SWITCH_END
+#undef INTERPRETER_CASE
+#undef INTERPRETER_HANDLER
+#undef INTERPRETER_NEXT
+#undef INTERPRETER_JUMP
+#undef INTERPRETER_BRANCH
+
+
+#ifdef LINEAR_CODE_JIT
+
+void LinearCodeInterpreter::InitializeJit(const GlobalFuncTable& global_func_table) {
+	auto GetCountdown = [](uint threshold) { return (int)std::min(threshold, (uint)std::numeric_limits<int>::max()); };
+	jit.reset(); jit_exception = nullptr;
+	jit_call_countdown.assign(global_func_table.size(), std::numeric_limits<int>::max());
+	jit_back_edge_countdown = std::numeric_limits<int>::max();
+	if (!option.enable_jit || execution_mode == ExecutionMode::Checked || profiler != nullptr) { return; }
+	jit_context = JitContext();
+	jit_context.owner = this;
+	jit_context.call_interpreted = execution_mode == ExecutionMode::Verified ?
+		JitCallInterpreted<ExecutionMode::Verified> : JitCallInterpreted<ExecutionMode::Unchecked>;
+	jit_context.call_library = JitCallLibrary;
+	jit_context.grow_stack = JitGrowStack;
+	LinearCodeJit::Option jit_option;
+	jit_option.check_indirect_access = execution_mode != ExecutionMode::Unchecked;
+	jit_option.poison_local_var = option.poison_local_var;
+	jit_option.local_var_initial_value = local_var_initial_value;
+	try {
+		jit = std::make_unique<LinearCodeJit>(jit_context, global_func_table, jit_option);
+	} catch (std::runtime_error&) {
+		return;  // interpret only
+	}
+	jit_call_countdown.assign(global_func_table.size(), GetCountdown(option.jit_call_threshold));
+	jit_back_edge_countdown = GetCountdown(option.jit_back_edge_threshold);
+}
+
+void LinearCodeInterpreter::StoreJitContext() {
+	jit_context.stack_base = var_stack.data();
+	jit_context.stack_size = var_stack.size();
+	jit_context.stack_top = stack_top;
+	jit_context.frame_pointer = frame_pointer;
+	jit_context.frame_size = current_func_frame_size;
+	jit_context.return_value = return_value;
+}
+
+void LinearCodeInterpreter::LoadJitContext() {
+	assert(jit_context.stack_base == var_stack.data());
+	stack_top = jit_context.stack_top;
+	frame_pointer = jit_context.frame_pointer;
+	current_func_frame_size = jit_context.frame_size;
+	return_value = jit_context.return_value;
+}
+
+void LinearCodeInterpreter::CheckJitStatus(JitStatus status) {
+	switch (status) {
+	case JitStatus::Success: return;
+	case JitStatus::Exception: {
+		std::exception_ptr exception = jit_exception; jit_exception = nullptr;
+		std::rethrow_exception(exception);
+	}
+	case JitStatus::SubscriptOutOfRange: throw std::runtime_error("array subscript out of range");
+	case JitStatus::StackOverflow: throw std::runtime_error("stack overflow");
+	default: assert(false); return;
+	}
+}
+
+bool LinearCodeInterpreter::CompileJitFunc(uint func_index) {
+	if (jit == nullptr) { return false; }
+	if (jit->IsCompiled(func_index) || jit->CompileFunc(func_index)) {
+		jit_call_countdown[func_index] = 0;  // called as compiled code from now on
+		return true;
+	}
+	jit_call_countdown[func_index] = std::numeric_limits<int>::max();
+	return false;
+}
+
+// Executes the function on the frame just entered, returns false if it's not compiled.
+bool LinearCodeInterpreter::ExecuteJitFunc(uint func_index) {
+	if (!CompileJitFunc(func_index)) { return false; }
+	StoreJitContext();
+	JitStatus status = jit->ExecuteFunc(func_index);
+	LoadJitContext();
+	CheckJitStatus(status);
+	return true;
+}
+
+// Executes the rest of the function running from the jump target, returns false if it's not compiled.
+bool LinearCodeInterpreter::ExecuteJitFuncFromBackEdge(const Instruction* target_pc) {
+	jit_back_edge_countdown = (int)std::min(option.jit_back_edge_threshold, (uint)std::numeric_limits<int>::max());
+	uint target = (uint)(target_pc - code.data());
+	auto func_record = std::upper_bound(func_record_table.begin(), func_record_table.end(), target,
+										[](uint target, const FuncRecord& func_record) { return target < func_record.entry; });
+	assert(func_record != func_record_table.begin());
+	uint func_index = (uint)(func_record - func_record_table.begin()) - 1;
+	const vector<uint>& label_pc = label_pc_table[func_index];
+	auto label = std::find(label_pc.begin(), label_pc.end(), target);
+	if (label == label_pc.end() || !CompileJitFunc(func_index)) { return false; }
+	StoreJitContext();
+	JitStatus status = jit->ExecuteFuncFromLabel(func_index, (uint)(label - label_pc.begin()));
+	LoadJitContext();
+	CheckJitStatus(status);
+	return true;
+}
+
+template<LinearCodeInterpreter::ExecutionMode mode>
+int LinearCodeInterpreter::JitCallInterpreted(JitContext* context, uint func_index) {
+	LinearCodeInterpreter& interpreter = *static_cast<LinearCodeInterpreter*>(context->owner);
+	try {
+		if (--interpreter.jit_call_countdown[func_index] < 0 && interpreter.CompileJitFunc(func_index)) {
+			return (int)interpreter.jit->ExecuteFunc(func_index);
+		}
+		interpreter.LoadJitContext();
+		interpreter.ExecuteFunc<mode>(func_index);
+		interpreter.StoreJitContext();
+	} catch (...) {
+		interpreter.jit_exception = std::current_exception();
+		return (int)JitStatus::Exception;
+	}
+	return (int)JitStatus::Success;
+}
+
+int LinearCodeInterpreter::JitCallLibrary(JitContext* context, uint func_index, int arg0, int arg1) {
+	LinearCodeInterpreter& interpreter = *static_cast<LinearCodeInterpreter*>(context->owner);
+	interpreter.LoadJitContext();
+	try {
+		uint array_size;
+		switch ((LibraryFunc)func_index) {
+		case LibraryFunc::GetArray: {
+			int* array_addr = interpreter.GetArrayArgument((uint)arg0, array_size);
+			context->return_value = LibraryGetArray(array_addr, array_size);
+			break;
+		}
+		case LibraryFunc::PutArray: {
+			int* array_addr = interpreter.GetArrayArgument((uint)arg1, array_size);
+			LibraryPutArray(arg0, array_addr, array_size);
+			break;
+		}
+		case LibraryFunc::StartTime: LibraryStartTime(arg0); break;
+		case LibraryFunc::StopTime: LibraryStopTime(arg0); break;
+		default: assert(false); break;
+		}
+	} catch (...) {
+		interpreter.jit_exception = std::current_exception();
+		return (int)JitStatus::Exception;
+	}
+	return (int)JitStatus::Success;
+}
+
+int LinearCodeInterpreter::JitGrowStack(JitContext* context, uint64 new_stack_top) {
+	LinearCodeInterpreter& interpreter = *static_cast<LinearCodeInterpreter*>(context->owner);
+	if (new_stack_top > interpreter.option.max_stack_size) { return (int)JitStatus::StackOverflow; }
+	try {
+		interpreter.GrowStack((uint)new_stack_top);
+	} catch (...) {
+		interpreter.jit_exception = std::current_exception();
+		return (int)JitStatus::Exception;
+	}
+	context->stack_base = interpreter.var_stack.data();
+	context->stack_size = interpreter.var_stack.size();
+	return (int)JitStatus::Success;
+}
+
+#endif
+
+
+void LinearCodeInterpreter::InitializeGlobalVar(const GlobalVarTable& global_var_table) {
+	if (global_var_table.length > option.max_stack_size) { throw std::runtime_error("stack overflow"); }
+	var_stack.clear(); var_stack.reserve(std::min(option.max_stack_size, stack_segment_size * 16));
+	var_stack.resize(global_var_table.length, global_var_initial_value);
+	stack_top = global_var_table.length;
+	for (auto [index, value] : global_var_table.initializing_list) {
+		assert(index < global_var_table.length);
+		SetValueAtGlobalIndex(index, value);
+	}
+	current_func_frame_size = global_var_table.length;
+	frame_pointer = 0;
+}
+
+void LinearCodeInterpreter::InitializeFuncTable(const GlobalFuncTable& global_func_table, uint global_var_length) {
+	global_func = &global_func_table;
+	profiler = nullptr;
+	if (option.profile_output != nullptr || option.sample_output != nullptr) {
+		profiler = std::make_unique<LinearCodeProfiler>(global_func_table, option.sample_output != nullptr ? std::max(option.sample_interval, 1u) : 0);
+	}
+	execution_mode = option.execution_mode;
+	if (execution_mode == ExecutionMode::Verified && !VerifyFuncTable(global_func_table, global_var_length)) {
+		execution_mode = ExecutionMode::Checked;
+	}
+	DecodeFuncTable(global_func_table);
+}
+
+void LinearCodeInterpreter::WriteProfile() {
+	if (profiler == nullptr) { return; }
+	if (option.profile_output != nullptr) { profiler->PrintReport(*option.profile_output); }
+	if (option.sample_output != nullptr) { profiler->PrintFoldedStacks(*option.sample_output); }
+}
+
+int LinearCodeInterpreter::ExecuteLinearCode(const LinearCode& linear_code) {
+	InitializeGlobalVar(linear_code.global_var_table);
+	InitializeFuncTable(linear_code.global_func_table, linear_code.global_var_table.length);
+#ifdef LINEAR_CODE_JIT
+	InitializeJit(linear_code.global_func_table);
+#endif
+	LibraryInitialize();
+	uint main_func_index = linear_code.main_func_index - library_func_number;
+	assert(main_func_index < func_record_table.size());
+	assert(func_record_table[main_func_index].parameter_count == 0);
+	EnterFunc(func_record_table[main_func_index]);
+	try {
+		switch (execution_mode) {
+		case ExecutionMode::Checked: ExecuteFunc<ExecutionMode::Checked>(main_func_index); break;
+		case ExecutionMode::Verified: ExecuteFunc<ExecutionMode::Verified>(main_func_index); break;
+		case ExecutionMode::Unchecked: ExecuteFunc<ExecutionMode::Unchecked>(main_func_index); break;
+		}
+	} catch (...) {
+		LibraryUninitialize();  // flush the output written before the error
+		WriteProfile();
+		throw;
+	}
+	LibraryUninitialize();
+	WriteProfile();
+	return return_value;
+}
\ No newline at end of file
@@ -2,40 +2,91 @@
 
 #include "linear_code.h"
 #include "library_function.h"
+#include "linear_code_jit.h"
+#include "linear_code_profiler.h"
 
 #include <vector>
+#include <memory>
+#include <exception>
 
 
 using std::vector;
 
 
+// Dispatch with computed goto (labels as values) where the compiler supports it, otherwise with a switch loop.
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(INTERPRETER_NO_COMPUTED_GOTO)
+#define INTERPRETER_COMPUTED_GOTO
+#endif
+
+
 class LinearCodeInterpreter {
+public:
+	// Checked: every variable access is bounds-checked.
+	// Verified: the variable indices fixed in the code are verified against the frame sizes when decoding, so only the
+	//   accesses through an address or with a variable subscript are checked. Runs as Checked if the verification fails.
+	// Unchecked: no access is checked, for trusted programs only.
+	enum class ExecutionMode : uchar { Checked, Verified, Unchecked };
+
+	struct Option {
+		uint max_stack_size = 1 << 24;	// in ints, including global variables
+		bool poison_local_var = true;	// fill each new frame with local_var_initial_value
+		ExecutionMode execution_mode = ExecutionMode::Verified;
+		bool enable_jit = true;			// compile hot functions to machine code where supported, except in Checked mode
+		uint jit_call_threshold = 64;	// calls of a function before it's compiled
+		uint jit_back_edge_threshold = 1 << 12;	// backward jumps before the function running is compiled and resumed
+		ref_ptr<std::ostream> profile_output = nullptr;	// profile the run and write the report to it, without JIT or superinstructions
+		ref_ptr<std::ostream> sample_output = nullptr;	// sample the call stack and write the folded stacks to it, likewise
+		uint sample_interval = 1 << 10;	// executed lines between samples
+	};
+
 private:
 	static constexpr int global_var_initial_value = 0;
 	static constexpr int local_var_initial_value = 0xCCCCCCCC;
-	static constexpr uint max_stack_size = 65536;
+	static constexpr uint stack_segment_size = 1 << 16;
+
+private:
+	const Option option;
+
+public:
+	LinearCodeInterpreter() : option() {}
+	LinearCodeInterpreter(Option option) : option(option) {}
 
 private:
+	// Global variables followed by the frames of the call chain. The stack is reserved once and
+	//   extended by whole segments when a call runs past its end, frames are never freed on return.
 	vector<int> var_stack;
+	uint stack_top = 0;
 	int return_value = 0;
 	uint frame_pointer = 0;
 	uint current_func_frame_size = 0;
-	ref_ptr<const LabelMap> current_func_label_map = nullptr;
 
 private:
+	void GrowStack(uint new_stack_top);
+	template<ExecutionMode mode = ExecutionMode::Checked>
 	void SetValueAtGlobalIndex(uint index, int value) {
-		if (index >= var_stack.size()) { throw std::runtime_error("array subscript out of range"); }
+		if constexpr (mode == ExecutionMode::Checked) {
+			if (index >= stack_top) { throw std::runtime_error("array subscript out of range"); }
+		}
 		var_stack[index] = value;
 	}
+	template<ExecutionMode mode = ExecutionMode::Checked>
 	void SetValueAtLocalIndex(uint index, int value) {
-		SetValueAtGlobalIndex(frame_pointer + index, value);
+		SetValueAtGlobalIndex<mode>(frame_pointer + index, value);
 	}
+	template<ExecutionMode mode = ExecutionMode::Checked>
 	int GetValueAtGlobalIndex(uint index) {
-		if (index >= var_stack.size()) { throw std::runtime_error("array subscript out of range"); }
+		if constexpr (mode == ExecutionMode::Checked) {
+			if (index >= stack_top) { throw std::runtime_error("array subscript out of range"); }
+		}
 		return var_stack[index];
 	}
+	template<ExecutionMode mode = ExecutionMode::Checked>
 	int GetValueAtLocalIndex(uint index) {
-		return GetValueAtGlobalIndex(frame_pointer + index);
+		return GetValueAtGlobalIndex<mode>(frame_pointer + index);
+	}
+	// The mode for accesses through an address or with a variable subscript, which can't be verified when decoding.
+	static constexpr ExecutionMode GetIndirectAccessMode(ExecutionMode mode) {
+		return mode == ExecutionMode::Unchecked ? ExecutionMode::Unchecked : ExecutionMode::Checked;
 	}
 
 private:
@@ -86,170 +137,244 @@ private:
 		default: assert(false); return 0;
 		}
 	}
-	int GetParameterValue(VarInfo var) {
-		assert(var.IsValid());
-		switch (var.type) {
-		case VarType::Addr:
-		case VarType::Local: return GetValueAtLocalIndex(var.value);
-		case VarType::Global: return GetValueAtGlobalIndex(var.value);
-		case VarType::Number: return var.value;
-		default: assert(false); return {};
+	template<ExecutionMode mode>
+	int GetOperandValue(VarType type, int value) {
+		switch (type) {
+		case VarType::Local: return GetValueAtLocalIndex<mode>(value);
+		case VarType::Global: return GetValueAtGlobalIndex<mode>(value);
+		case VarType::Number: return value;
+		default: assert(false); return 0;
 		}
 	}
-	Argument GetLibraryFuncParameterValue(VarInfo var) {
-		assert(var.IsValid());
-		switch (var.type) {
-		case VarType::Local: return Argument(GetValueAtLocalIndex(var.value));
-		case VarType::Global: return Argument(GetValueAtGlobalIndex(var.value));
-		case VarType::Number: return Argument(var.value);
-		case VarType::Addr: {
-				uint offset = GetValueAtLocalIndex(var.value);
-				uint length = (uint)var_stack.size() > offset ? (uint)var_stack.size() - offset : 0;
-				return Argument(var_stack.data() + offset, length);
-			}
-		default: assert(false); return {};
-		}
+	// the range [addr, addr + length) of a bulk operation, which is always checked
+	ref_ptr<int> GetRange(uint addr, uint length) {
+		if ((uint64)addr + length > stack_top) { throw std::runtime_error("array subscript out of range"); }
+		return var_stack.data() + addr;
 	}
+	// an array passed to a library function, which may extend to the top of the stack
+	ref_ptr<int> GetArrayArgument(uint addr, uint& array_size) {
+		array_size = stack_top > addr ? stack_top - addr : 0;
+		return var_stack.data() + addr;
+	}
+private:
+	// Each CodeBlock is decoded into instructions whose opcodes are specialized by operand kind:
+	//   L for a local variable, G for a global variable, N for a number, A for a local holding an address.
+	//   Jump targets are resolved to instruction indices and call targets to function records.
+	//   Operand combinations without a specialized opcode are executed by the generic opcodes.
+	//   Frequent sequences of lines are fused into superinstructions, which may take their extra operands
+	//   from the Operand instructions following them.
+#define INTERPRETER_ARITHMETIC_OPERATOR_LIST(X) X(Add, +) X(Sub, -) X(Mul, *) X(Div, /) X(Mod, %)
+#define INTERPRETER_COMPARISON_OPERATOR_LIST(X) \
+	X(Equal, ==) X(NotEqual, !=) X(Less, <) X(Greater, >) X(LessEqual, <=) X(GreaterEuqal, >=)
+#define INTERPRETER_BINARY_OPERATOR_LIST(X) INTERPRETER_ARITHMETIC_OPERATOR_LIST(X) INTERPRETER_COMPARISON_OPERATOR_LIST(X)
+
+	enum class Opcode : uchar {
+		BinaryOp,		// generic, a: index of the line in generic_line_table
+		UnaryOp,		// generic
+		Addr,			// generic
+		Load,			// generic
+		Store,			// generic
+		JumpIf,			// generic, b: target
+		Fill,			// generic
+		MemCopy,		// generic
+
+#define INTERPRETER_BINARY_OPCODE(name, op) name##_LLL, name##_LLN, name##_LNL,		// a = b op c
+		INTERPRETER_BINARY_OPERATOR_LIST(INTERPRETER_BINARY_OPCODE)
+#undef INTERPRETER_BINARY_OPCODE
+		Neg_LL,			// a = -b
+		Not_LL,			// a = !b
+		Move_LL,		// a = b
+		Move_LN,
+		Move_LG,
+		Move_GL,
+		Move_GN,
+
+		AddrLocal_N,	// a = &local[b]
+		AddrLocal_L,	// a = &local[b + c]
+		AddrGlobal_L,	// a = &global[b + c]
+		AddrAddr_N,		// a = b + c (b holds an address)
+		AddrAddr_L,
+
+		Load_LAN,		// a = b[c]
+		Load_LAL,
+		Load_LLL,
+		Load_LGL,
+		Store_ANL,		// a[b] = c
+		Store_ANN,
+		Store_ALL,
+		Store_ALN,
+		Store_LLL,
+		Store_LLN,
+		Store_GLL,
+		Store_GLN,
+
+		LoadIndexed_L,	// c = &b[c], a = *c, b as a local array
+		LoadIndexed_G,	// b as a global array
+		LoadIndexed_A,	// b as a local holding an address
+		StoreIndexed_LL,	// a = &b[a], *a = c
+		StoreIndexed_LN,
+		StoreIndexed_GL,
+		StoreIndexed_GN,
+		StoreIndexed_AL,
+		StoreIndexed_AN,
+
+#define INTERPRETER_MOVE_OPCODE(name, op) name##Move_LLL, name##Move_LLN, name##Move_LNL,	// a = b op c, next.a = a
+		INTERPRETER_ARITHMETIC_OPERATOR_LIST(INTERPRETER_MOVE_OPCODE)
+#undef INTERPRETER_MOVE_OPCODE
+
+#define INTERPRETER_JUMP_OPCODE(name, op) Jump##name##_LL, Jump##name##_LN,	// goto a if b op c
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_JUMP_OPCODE)
+#undef INTERPRETER_JUMP_OPCODE
+#define INTERPRETER_COMPARE_JUMP_OPCODE(name, op) CompareJump##name##_LL, CompareJump##name##_LN,	// a = b op c, goto next.a if a != next.b
+		INTERPRETER_COMPARISON_OPERATOR_LIST(INTERPRETER_COMPARE_JUMP_OPCODE)
+#undef INTERPRETER_COMPARE_JUMP_OPCODE
+		Goto,			// goto a
+
+		Call,			// call func_record_table[a], with each argument in an Operand instruction following it
+		GetInt,			// return value = getint()
+		GetCh,			// return value = getch()
+		GetArray,		// return value = getarray(a), a: the local holding the array address
+		PutInt_L,		// putint(a)
+		PutInt_N,
+		PutInt_G,
+		PutCh_L,		// putch(a)
+		PutCh_N,
+		PutCh_G,
+		PutArray,		// putarray(b, c), a: the VarType of b, c: the local holding the array address
+		StartTime,		// _sysy_starttime(b), a: the VarType of b
+		StopTime,		// _sysy_stoptime(b), a: the VarType of b
+		Result_L,		// a = return value
+		Result_G,
+		Return_V,		// return
+		Return_L,		// return a
+		Return_N,
+		Return_G,
+
+		ProfileLine,		// count the line with profiler counter a
+		ProfileFallThrough,	// count the JumpIf not taken with profiler counter a
+		ProfileEnter,		// enter function a
+		ProfileLeave,		// leave the current function
+
+		Operand,		// extra operands of the preceding instruction, never executed
+
+		_Count,
+	};
+
+#ifdef INTERPRETER_COMPUTED_GOTO
+	using Handler = const void*;
+#else
+	using Handler = Opcode;
+#endif
+
+	struct Instruction {
+		Handler handler;	// direct-threaded handler of opcode
+		Opcode opcode;
+		OperatorType op;	// for generic opcodes
+		int a;
+		int b;
+		int c;
+	};
+	static_assert(sizeof(Instruction) <= 24);
+
+	struct GenericLine {
+		ref_ptr<const CodeLine> line;
+		uint target;		// for JumpIf
+	};
+
+	struct FuncRecord {
+		uint entry;
+		uint frame_size;
+		uint parameter_count;
+	};
+
+	ref_ptr<const GlobalFuncTable> global_func = nullptr;
+	vector<Instruction> code;
+	vector<GenericLine> generic_line_table;
+	vector<FuncRecord> func_record_table;
+	ExecutionMode execution_mode = ExecutionMode::Checked;	// option.execution_mode, or Checked if the verification failed
 
 private:
-	void ExecuteCodeLine(const CodeBlock& code_block, uint line_no) {
-		if (line_no >= code_block.size()) { return; }
-		const CodeLine& line = code_block[line_no];
-		switch (line.type) {
-		case CodeLineType::BinaryOp:
-			SetVarValue(VarInfo(line, 0), EvalBinaryOperator(line.op, GetVarValue(VarInfo(line, 1)), GetVarValue(VarInfo(line, 2))));
-			break;
-		case CodeLineType::UnaryOp:
-			SetVarValue(VarInfo(line, 0), EvalUnaryOperator(line.op, GetVarValue(VarInfo(line, 1))));
-			break;
-		case CodeLineType::Addr:
-			SetAddr(VarInfo(line, 0), GetVarAddr(VarInfo(line, 1), GetVarValue(VarInfo(line, 2))));
-			break;
-		case CodeLineType::Load:
-			SetVarValue(VarInfo(line, 0), GetValueAtGlobalIndex(GetVarAddr(VarInfo(line, 1), GetVarValue(VarInfo(line, 2)))));
-			break;
-		case CodeLineType::Store:
-			SetValueAtGlobalIndex(GetVarAddr(VarInfo(line, 0), GetVarValue(VarInfo(line, 1))), GetVarValue(VarInfo(line, 2)));
-			break;
-		case CodeLineType::FuncCall:
-			CallFunc(code_block, line_no);
-			if (line.var_type[1] != CodeLineVarType::Type::Empty) {
-				SetVarValue(VarInfo(line, 1), return_value);
-			}
-			break;
-		case CodeLineType::JumpIf:
-			if (EvalBinaryOperator(line.op, GetVarValue(VarInfo(line, 1)), GetVarValue(VarInfo(line, 2)))) {
-				return ExecuteCodeLine(code_block, current_func_label_map->operator[](line.var[0]));
-			} else {
-				break;
-			}
-		case CodeLineType::Goto:
-			return ExecuteCodeLine(code_block, current_func_label_map->operator[](line.var[0]));
-		case CodeLineType::Return:
-			if (line.var_type[0] != CodeLineVarType::Type::Empty) {
-				return_value = GetVarValue(VarInfo(line, 0));
-			}
-			return;
-		default:
-			assert(false);
-			return;
-		}
-		return ExecuteCodeLine(code_block, line_no + 1);
-	}
-	void ExecuteCodeBlock(const CodeBlock& code_block) {
-		return ExecuteCodeLine(code_block, 0);
-	}
-	int ReadParameter(const CodeBlock& code_block, uint line_no) {
-		const CodeLine& line = code_block[line_no];
-		assert(line.type == CodeLineType::Parameter);
-		return GetParameterValue(VarInfo(line, 0));
-	}
-	Argument ReadLibraryFuncParameter(const CodeBlock& code_block, uint line_no) {
-		const CodeLine& line = code_block[line_no];
-		assert(line.type == CodeLineType::Parameter);
-		return GetLibraryFuncParameterValue(VarInfo(line, 0));
-	}
-	void CallFunc(const CodeBlock& code_block, uint& line_no) {
-		assert(line_no < code_block.size());
-		uint func_index = code_block[line_no].var[0];
-		if (IsLibraryFunc(func_index)) {
-			uint parameter_count = GetLibraryFuncParameterCount(func_index);
-			vector<Argument> args; args.reserve(parameter_count);
-			for(uint i = 0; i < parameter_count; ++i) {
-				line_no++;
-				args.push_back(ReadLibraryFuncParameter(code_block, line_no));
-			}
-			switch (parameter_count) {
-			case 0: return CallLibraryFunc(func_index, Argument(), Argument(), return_value); 
-			case 1: return CallLibraryFunc(func_index, args[0], Argument(), return_value);
-			case 2: return CallLibraryFunc(func_index, args[0], args[1], return_value);
-			default: assert(false); return;
-			}
-		} else {
-			func_index -= library_func_number;
-			assert(func_index < global_func->size());
-			auto& func_def = global_func->operator[](func_index);
-			assert(func_def.parameter_count <= func_def.local_var_length);
-			if (var_stack.size() + func_def.local_var_length > max_stack_size) { throw std::runtime_error("stack overflow"); }
-			uint old_func_frame_size = current_func_frame_size;
-			ref_ptr<const LabelMap> old_func_label_map = current_func_label_map;
-			current_func_label_map = &func_def.label_map;
-			current_func_frame_size = func_def.local_var_length;
-			var_stack.insert(var_stack.end(), current_func_frame_size, 0xCCCCCCCC);
-			uint new_frame_pointer = frame_pointer + old_func_frame_size;
-			for (uint i = 0; i < func_def.parameter_count; ++i) {
-				line_no++;
-				var_stack[new_frame_pointer + i] = ReadParameter(code_block, line_no);
-			}
-			frame_pointer = new_frame_pointer;
-			ExecuteCodeBlock(func_def.code_block);
-			var_stack.erase(var_stack.begin() + frame_pointer, var_stack.end());
-			frame_pointer -= old_func_frame_size;
-			current_func_frame_size = old_func_frame_size;
-			current_func_label_map = old_func_label_map;
-		}
+	void AppendInstruction(Opcode opcode, int a = 0, int b = 0, int c = 0, OperatorType op = OperatorType::None) {
+		code.push_back(Instruction{ Handler(), opcode, op, a, b, c });
 	}
-	void CallMainFunc(uint main_func_index) {
-		main_func_index -= library_func_number;
-		assert(main_func_index < global_func->size());
-		auto& func_def = global_func->operator[](main_func_index);
-		assert(func_def.parameter_count == 0);
-		if (var_stack.size() + func_def.local_var_length > max_stack_size) { throw std::runtime_error("stack overflow"); }
-		uint old_func_frame_size = current_func_frame_size;
-		ref_ptr<const LabelMap> old_func_label_map = current_func_label_map;
-		current_func_label_map = &func_def.label_map;
-		current_func_frame_size = func_def.local_var_length;
-		var_stack.insert(var_stack.end(), current_func_frame_size, local_var_initial_value);
-		frame_pointer += old_func_frame_size;
-		ExecuteCodeBlock(func_def.code_block);
-		var_stack.erase(var_stack.begin() + frame_pointer, var_stack.end());
-		frame_pointer -= old_func_frame_size;
-		current_func_frame_size = old_func_frame_size;
-		current_func_label_map = old_func_label_map;
+	void AppendGenericInstruction(Opcode opcode, const CodeLine& line, uint target = 0) {
+		AppendInstruction(opcode, (int)generic_line_table.size());
+		generic_line_table.push_back(GenericLine{ &line, target });
 	}
+	void DecodeBinaryOp(const CodeLine& line);
+	void DecodeUnaryOp(const CodeLine& line);
+	void DecodeAddr(const CodeLine& line);
+	void DecodeLoad(const CodeLine& line);
+	void DecodeStore(const CodeLine& line);
+	void DecodeMove(VarInfo dest, int dest_offset, VarInfo src, const CodeLine& line, Opcode generic_opcode);
+	void DecodeLibraryFuncCall(const CodeBlock& code_block, uint& line_no);
+	void DecodeFuncCall(const CodeBlock& code_block, uint& line_no);
+	void DecodeJumpIf(const CodeLine& line, uint target);
+	bool DecodeAddrLoad(const CodeLine& addr_line, const CodeLine& load_line);
+	bool DecodeAddrStore(const CodeLine& addr_line, const CodeLine& store_line);
+	bool DecodeBinaryOpMove(const CodeLine& line, const CodeLine& store_line);
+	bool DecodeCompareJumpIf(const CodeLine& line, const CodeLine& jump_line);
+	bool DecodeSuperinstruction(const CodeBlock& code_block, uint& line_no, const vector<bool>& is_jump_target,
+								vector<std::pair<uint, uint>>& jump_list);
+	void AppendJumpIf(uint target, OperatorType op, VarInfo src1, VarInfo src2, const CodeLine& line);
+	void DecodeReturn(const CodeLine& line);
+	void DecodeFuncDef(const GlobalFuncDef& func_def);
+	void DecodeFuncTable(const GlobalFuncTable& global_func_table);
+	bool VerifyFuncDef(const GlobalFuncDef& func_def, uint global_var_length);
+	bool VerifyFuncTable(const GlobalFuncTable& global_func_table, uint global_var_length);
+	void ThreadCode(const Handler handler_table[(uchar)Opcode::_Count]);
+	ref_ptr<const Handler> threaded_handler_table = nullptr;
 
 private:
-	ref_ptr<const GlobalFuncTable> global_func = nullptr;
+	// The dispatch loop keeps an explicit program counter and an explicit call stack,
+	//   so neither long loops nor deep recursion in the interpreted program consume the C++ stack.
+	struct CallFrame {
+		uint return_pc;
+		uint frame_pointer;
+		uint frame_size;
+	};
+	vector<CallFrame> call_stack;
+
 private:
-	void InitializeGlobalVar(const GlobalVarTable& global_var_table) {
-		var_stack.insert(var_stack.end(), global_var_table.length, global_var_initial_value);
-		for (auto [index, value] : global_var_table.initializing_list) {
-			assert(index < global_var_table.length);
-			SetValueAtGlobalIndex(index, value);
-		}
-		current_func_frame_size = global_var_table.length;
-		frame_pointer = 0;
-	}
-	void InitializeFuncTable(const GlobalFuncTable& global_func_table) {
-		global_func = &global_func_table;
-	}
+	std::unique_ptr<LinearCodeProfiler> profiler;  // only when profiling, then the profiling instructions are decoded
+	void WriteProfile();
+
+private:
+	int* AllocateFrame(const FuncRecord& func_record);
+	void ActivateFrame(const FuncRecord& func_record);
+	void EnterFunc(const FuncRecord& func_record);
+	void LeaveFunc();
+	template<ExecutionMode mode>
+	void ExecuteFunc(uint func_index);
+
+#ifdef LINEAR_CODE_JIT
+private:
+	// Hot functions are compiled by LinearCodeJit, then called directly, or resumed at the backward jump
+	//   that triggered the compilation. Errors in compiled code are returned as JitStatus and thrown here.
+	JitContext jit_context;
+	std::unique_ptr<LinearCodeJit> jit;
+	std::exception_ptr jit_exception;
+	vector<int> jit_call_countdown;
+	int jit_back_edge_countdown = 0;
+	vector<vector<uint>> label_pc_table;  // the instruction index of each label of each function
+
+private:
+	void InitializeJit(const GlobalFuncTable& global_func_table);
+	void StoreJitContext();
+	void LoadJitContext();
+	void CheckJitStatus(JitStatus status);
+	bool CompileJitFunc(uint func_index);
+	bool ExecuteJitFunc(uint func_index);
+	bool ExecuteJitFuncFromBackEdge(const Instruction* target_pc);
+	template<ExecutionMode mode>
+	static int JitCallInterpreted(JitContext* context, uint func_index);
+	static int JitCallLibrary(JitContext* context, uint func_index, int arg0, int arg1);
+	static int JitGrowStack(JitContext* context, uint64 new_stack_top);
+#endif
+
+private:
+	void InitializeGlobalVar(const GlobalVarTable& global_var_table);
+	void InitializeFuncTable(const GlobalFuncTable& global_func_table, uint global_var_length);
 public:
-	int ExecuteLinearCode(const LinearCode& linear_code) {
-		InitializeGlobalVar(linear_code.global_var_table);
-		InitializeFuncTable(linear_code.global_func_table);
-		LibraryInitialize();
-		CallMainFunc(linear_code.main_func_index);
-		LibraryUninitialize();
-		return return_value;
-	}
+	int ExecuteLinearCode(const LinearCode& linear_code);
 };
\ No newline at end of file
@@ -0,0 +1,375 @@
+#include "linear_code_ir.h"
+#include "temp_var_packer.h"
+
+#include <algorithm>
+
+
+FuncIR::FuncIR(const GlobalFuncDef& func_def) :
+	parameter_count(func_def.parameter_count), is_int(func_def.is_int),
+	memory_length(func_def.parameter_count), local_array_list(func_def.local_array_list) {
+	const CodeBlock& code_block = func_def.code_block;
+	const uint line_count = (uint)code_block.size();
+	const uint slot_count = func_def.local_var_length;
+	std::sort(local_array_list.begin(), local_array_list.end());
+
+	// arrays of sibling blocks may share slots, so overlapping arrays are merged into one alias class
+	LocalArrayList merged_array_list;
+	for (auto [index, length] : local_array_list) {
+		if (!merged_array_list.empty() && index < merged_array_list.back().first + merged_array_list.back().second) {
+			auto& [last_index, last_length] = merged_array_list.back();
+			last_length = std::max(last_length, index + length - last_index);
+		} else {
+			merged_array_list.emplace_back(index, length);
+		}
+	}
+	local_array_list = std::move(merged_array_list);
+
+	// elements of arrays are kept in memory, and the slot of a pointer is a register apart from its scalar register
+	vector<bool> is_memory(slot_count, false), is_pointer_slot(slot_count, false);
+	for (auto [index, length] : local_array_list) {
+		assert(index + length <= slot_count);
+		std::fill(is_memory.begin() + index, is_memory.begin() + index + length, true);
+	}
+	for (const CodeLine& line : code_block) {
+		for (uint i = 0; i < 3; ++i) {
+			if (line.var_type[i] == CodeLineVarType::Type::Addr) { is_pointer_slot[line.var[i]] = true; }
+		}
+		uint base = line.type == CodeLineType::Store ? 0 : 1;
+		if ((line.type == CodeLineType::Addr || line.type == CodeLineType::Load || line.type == CodeLineType::Store) &&
+			line.var_type[base] == CodeLineVarType::Type::Local &&
+			(line.type == CodeLineType::Addr || !(line.var_type[base + 1] == CodeLineVarType::Type::Number && line.var[base + 1] == 0))) {
+			is_memory[line.var[base]] = true;
+		}
+		if (line.type == CodeLineType::Fill || line.type == CodeLineType::MemCopy) {
+			if (line.var_type[0] == CodeLineVarType::Type::Local) { is_memory[line.var[0]] = true; }
+			if (line.type == CodeLineType::MemCopy && line.var_type[2] == CodeLineVarType::Type::Local) { is_memory[line.var[2]] = true; }
+		}
+	}
+	for (uint index = 0; index < slot_count; ++index) {
+		if (is_memory[index]) { memory_length = std::max(memory_length, index + 1); }
+	}
+	reg_is_pointer.assign(slot_count * 2, false);
+	std::fill(reg_is_pointer.begin() + slot_count, reg_is_pointer.end(), true);
+	for (uint i = 0; i < parameter_count; ++i) {
+		assert(!is_memory[i]);
+		parameter_reg.push_back(is_pointer_slot[i] ? slot_count + i : i);
+	}
+	auto GetOperand = [&](const CodeLine& line, uint i) -> IROperand {
+		switch (line.var_type[i]) {
+		case CodeLineVarType::Type::Number: return IROperand::Number(line.var[i]);
+		case CodeLineVarType::Type::Local: return is_memory[line.var[i]] ? IROperand::Local(line.var[i]) : IROperand::Reg(line.var[i]);
+		case CodeLineVarType::Type::Global: return IROperand::Global(line.var[i]);
+		case CodeLineVarType::Type::Addr: return IROperand::Reg(slot_count + line.var[i]);
+		default: return IROperand();
+		}
+	};
+	// a scalar in memory at a constant offset is a memory operand
+	auto GetMemoryOperand = [](IROperand begin, int offset) {
+		begin.value += offset; return begin;
+	};
+
+	// split basic blocks, with a returning block at the end if the code falls through or jumps to the end,
+	//   and an empty entry block if the first line is jumped to
+	vector<bool> is_block_begin(line_count + 1, false);
+	is_block_begin[0] = true;
+	bool is_first_line_target = false;
+	for (uint line_no = 0; line_no < line_count; ++line_no) {
+		const CodeLine& line = code_block[line_no];
+		if (line.type == CodeLineType::JumpIf || line.type == CodeLineType::Goto) {
+			if (func_def.label_map[line.var[0]] == 0) { is_first_line_target = true; }
+			is_block_begin[func_def.label_map[line.var[0]]] = true;
+			is_block_begin[line_no + 1] = true;
+		} else if (line.type == CodeLineType::Return) {
+			is_block_begin[line_no + 1] = true;
+		}
+	}
+	if (line_count == 0 || (code_block.back().type != CodeLineType::Return && code_block.back().type != CodeLineType::Goto)) {
+		is_block_begin[line_count] = true;
+	}
+	if (is_first_line_target) { block_list.emplace_back(); block_list.back().SetGoto(1); }
+	vector<uint> line_block(line_count + 1, -1);
+	for (uint line_no = 0; line_no <= line_count; ++line_no) {
+		if (is_block_begin[line_no]) { line_block[line_no] = (uint)block_list.size(); block_list.emplace_back(); }
+	}
+
+	for (uint line_no = 0, block = -1; line_no < line_count; ++line_no) {
+		if (is_block_begin[line_no]) { block = line_block[line_no]; }
+		IRBlock& ir_block = block_list[block];
+		const CodeLine& line = code_block[line_no];
+		switch (line.type) {
+		case CodeLineType::BinaryOp:
+			ir_block.instr_list.push_back(IRInstr::BinaryOp(line.op, GetOperand(line, 0), GetOperand(line, 1), GetOperand(line, 2)));
+			break;
+		case CodeLineType::UnaryOp:
+			ir_block.instr_list.push_back(IRInstr::UnaryOp(line.op, GetOperand(line, 0), GetOperand(line, 1)));
+			break;
+		case CodeLineType::Addr:
+			ir_block.instr_list.push_back(IRInstr::Addr(GetOperand(line, 0), GetOperand(line, 1), GetOperand(line, 2)));
+			break;
+		case CodeLineType::Load: {
+				IROperand dest = GetOperand(line, 0), src_begin = GetOperand(line, 1), src_offset = GetOperand(line, 2);
+				if (src_begin.IsReg() && !reg_is_pointer[src_begin.GetReg()]) {
+					assert(src_offset.IsNumber(0));
+					ir_block.instr_list.push_back(IRInstr::Copy(dest, src_begin));
+				} else if (src_begin.IsMemory() && src_offset.IsNumber()) {
+					ir_block.instr_list.push_back(IRInstr::Copy(dest, GetMemoryOperand(src_begin, src_offset.value)));
+				} else {
+					ir_block.instr_list.push_back(IRInstr::Load(dest, src_begin, src_offset));
+				}
+			}
+			break;
+		case CodeLineType::Store: {
+				IROperand dest_begin = GetOperand(line, 0), dest_offset = GetOperand(line, 1), src = GetOperand(line, 2);
+				if (dest_begin.IsReg() && !reg_is_pointer[dest_begin.GetReg()]) {
+					assert(dest_offset.IsNumber(0));
+					ir_block.instr_list.push_back(IRInstr::Copy(dest_begin, src));
+				} else if (dest_begin.IsMemory() && dest_offset.IsNumber()) {
+					ir_block.instr_list.push_back(IRInstr::Copy(GetMemoryOperand(dest_begin, dest_offset.value), src));
+				} else {
+					ir_block.instr_list.push_back(IRInstr::Store(dest_begin, dest_offset, src));
+				}
+			}
+			break;
+		case CodeLineType::Fill:
+			ir_block.instr_list.push_back(IRInstr::Fill(GetOperand(line, 0), GetOperand(line, 1), GetOperand(line, 2)));
+			break;
+		case CodeLineType::MemCopy:
+			ir_block.instr_list.push_back(IRInstr::MemCopy(GetOperand(line, 0), GetOperand(line, 1), GetOperand(line, 2)));
+			break;
+		case CodeLineType::FuncCall: {
+				vector<IROperand> argument_list;
+				while (line_no + 1 < line_count && code_block[line_no + 1].type == CodeLineType::Parameter) {
+					argument_list.push_back(GetOperand(code_block[++line_no], 0));
+				}
+				ir_block.instr_list.push_back(IRInstr::Call(line.var[0], GetOperand(line, 1), std::move(argument_list)));
+			}
+			break;
+		case CodeLineType::JumpIf:
+			ir_block.exit_type = IRExitType::JumpIf; ir_block.exit_op = line.op;
+			ir_block.exit_var[0] = GetOperand(line, 1); ir_block.exit_var[1] = GetOperand(line, 2);
+			ir_block.target = line_block[func_def.label_map[line.var[0]]];
+			ir_block.next = line_block[line_no + 1];
+			break;
+		case CodeLineType::Goto:
+			ir_block.SetGoto(line_block[func_def.label_map[line.var[0]]]);
+			break;
+		case CodeLineType::Return:
+			ir_block.exit_type = IRExitType::Return;
+			ir_block.exit_var[0] = GetOperand(line, 0);
+			break;
+		default:
+			assert(false);
+			break;
+		}
+		bool is_exit = line.type == CodeLineType::JumpIf || line.type == CodeLineType::Goto || line.type == CodeLineType::Return;
+		if (!is_exit && is_block_begin[line_no + 1]) { ir_block.SetGoto(line_block[line_no + 1]); }
+	}
+	UpdatePredecessor();
+}
+
+GlobalFuncDef FuncIR::Lower() const {
+	vector<uint> reg_slot(GetRegCount());
+	for (uint reg = 0; reg < GetRegCount(); ++reg) { reg_slot[reg] = temp_var_index_begin + reg; }
+	for (uint i = 0; i < parameter_count; ++i) { reg_slot[parameter_reg[i]] = i; }
+	auto GetVarInfo = [&](IROperand operand) {
+		switch (operand.type) {
+		case IROperandType::Number: return VarInfo::Number(operand.value);
+		case IROperandType::Reg:
+			return reg_is_pointer[operand.GetReg()] ? VarInfo::ArrayPtr({}, reg_slot[operand.GetReg()]) : VarInfo::Temp(reg_slot[operand.GetReg()]);
+		case IROperandType::Local: assert((uint)operand.value < memory_length); return VarInfo::VarRef(false, operand.value);
+		case IROperandType::Global: return VarInfo::VarRef(true, operand.value);
+		default: assert(false); return VarInfo::Void();
+		}
+	};
+
+	// lay out chains of blocks falling through to their next blocks or goto targets, from blocks in their order;
+	//   a goto target still reached from unplaced blocks, like the test at the bottom of a loop, is left to them
+	vector<uint> layout; layout.reserve(block_list.size());
+	vector<bool> is_placed(block_list.size(), false);
+	vector<uint> unplaced_predecessor_count(block_list.size(), 0);
+	for (const IRBlock& ir_block : block_list) {
+		for (uint successor : ir_block.GetSuccessorList()) { unplaced_predecessor_count[successor]++; }
+	}
+	for (uint begin = 0; begin < block_list.size(); ++begin) {
+		for (uint block = begin; block != -1 && !is_placed[block];) {
+			is_placed[block] = true; layout.push_back(block);
+			const IRBlock& ir_block = block_list[block];
+			for (uint successor : ir_block.GetSuccessorList()) { unplaced_predecessor_count[successor]--; }
+			if (ir_block.exit_type == IRExitType::Goto) {
+				block = unplaced_predecessor_count[ir_block.target] == 0 ? ir_block.target : -1;
+			} else {
+				block = ir_block.exit_type == IRExitType::JumpIf ? ir_block.next : -1;
+			}
+		}
+	}
+
+	CodeBlock code_block; LabelMap label_map(block_list.size());
+	for (uint i = 0; i < layout.size(); ++i) {
+		const uint block = layout[i], next_block = i + 1 < layout.size() ? layout[i + 1] : -1;
+		const IRBlock& ir_block = block_list[block];
+		label_map[block] = (uint)code_block.size();
+		for (const IRInstr& instr : ir_block.instr_list) {
+			switch (instr.type) {
+			case IRInstrType::BinaryOp:
+				code_block.push_back(CodeLine::BinaryOperation(instr.op, GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), GetVarInfo(instr.var[2])));
+				break;
+			case IRInstrType::UnaryOp:
+				code_block.push_back(CodeLine::UnaryOperation(instr.op, GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1])));
+				break;
+			case IRInstrType::Copy:
+				if (instr.var[0].IsReg() && reg_is_pointer[instr.var[0].GetReg()]) {
+					code_block.push_back(CodeLine::Addr(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), VarInfo::Number(0)));
+				} else {
+					code_block.push_back(CodeLine::Assign(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1])));
+				}
+				break;
+			case IRInstrType::Addr:
+				code_block.push_back(CodeLine::Addr(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), GetVarInfo(instr.var[2])));
+				break;
+			case IRInstrType::Load:
+				code_block.push_back(CodeLine::Load(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), GetVarInfo(instr.var[2])));
+				break;
+			case IRInstrType::Store:
+				code_block.push_back(CodeLine::Store(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), GetVarInfo(instr.var[2])));
+				break;
+			case IRInstrType::Fill:
+				code_block.push_back(CodeLine::Fill(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), GetVarInfo(instr.var[2])));
+				break;
+			case IRInstrType::MemCopy:
+				code_block.push_back(CodeLine::MemCopy(GetVarInfo(instr.var[0]), GetVarInfo(instr.var[1]), GetVarInfo(instr.var[2])));
+				break;
+			case IRInstrType::Call:
+				code_block.push_back(instr.var[0].IsEmpty() ?
+					CodeLine::VoidFuncCall(instr.func_index) : CodeLine::IntFuncCall(instr.func_index, GetVarInfo(instr.var[0])));
+				for (auto& argument : instr.argument_list) { code_block.push_back(CodeLine::Parameter(GetVarInfo(argument))); }
+				break;
+			default:
+				assert(false);  // phis must be removed before lowering
+				break;
+			}
+		}
+		switch (ir_block.exit_type) {
+		case IRExitType::Goto:
+			if (ir_block.target != next_block) { code_block.push_back(CodeLine::Goto(ir_block.target)); }
+			break;
+		case IRExitType::JumpIf:
+			if (ir_block.target == next_block && ir_block.next != next_block) {
+				OperatorType op = GetInverseCompareOperator(ir_block.exit_op);
+				code_block.push_back(CodeLine::JumpIf(ir_block.next, op, GetVarInfo(ir_block.exit_var[0]), GetVarInfo(ir_block.exit_var[1])));
+			} else {
+				code_block.push_back(CodeLine::JumpIf(ir_block.target, ir_block.exit_op, GetVarInfo(ir_block.exit_var[0]), GetVarInfo(ir_block.exit_var[1])));
+				if (ir_block.next != next_block) { code_block.push_back(CodeLine::Goto(ir_block.next)); }
+			}
+			break;
+		case IRExitType::Return:
+			if (ir_block.exit_var[0].IsEmpty() && next_block == -1) { break; }  // falls off the end
+			code_block.push_back(ir_block.exit_var[0].IsEmpty() ? CodeLine::ReturnVoid() : CodeLine::ReturnInt(GetVarInfo(ir_block.exit_var[0])));
+			break;
+		default:
+			assert(false);
+			break;
+		}
+	}
+	uint local_var_length = PackTempVar(code_block, label_map, GetRegCount(), memory_length);
+	return GlobalFuncDef{ parameter_count, local_var_length, is_int, std::move(code_block), std::move(label_map), local_array_list };
+}
+
+uint FuncIR::GetLocalArray(uint slot) const {
+	auto it = std::upper_bound(local_array_list.begin(), local_array_list.end(), std::make_pair(slot, (uint)-1));
+	if (it == local_array_list.begin() || slot >= (it - 1)->first + (it - 1)->second) { return -1; }
+	return (uint)(it - local_array_list.begin() - 1);
+}
+
+void FuncIR::UpdatePredecessor() {
+	vector<vector<uint>> old_predecessor_list(block_list.size());
+	for (uint block = 0; block < block_list.size(); ++block) {
+		old_predecessor_list[block] = std::move(block_list[block].predecessor_list);
+		block_list[block].predecessor_list.clear();
+	}
+	for (uint block = 0; block < block_list.size(); ++block) {
+		for (uint successor : block_list[block].GetSuccessorList()) { block_list[successor].predecessor_list.push_back(block); }
+	}
+	for (uint block = 0; block < block_list.size(); ++block) {
+		IRBlock& ir_block = block_list[block];
+		if (ir_block.predecessor_list == old_predecessor_list[block]) { continue; }
+		for (uint i = 0; i < ir_block.GetPhiCount(); ++i) {
+			vector<IROperand>& argument_list = ir_block.instr_list[i].argument_list;
+			vector<IROperand> new_argument_list;
+			for (uint predecessor : ir_block.predecessor_list) {
+				auto it = std::find(old_predecessor_list[block].begin(), old_predecessor_list[block].end(), predecessor);
+				assert(it != old_predecessor_list[block].end());  // a new edge must be added with its arguments
+				new_argument_list.push_back(argument_list[it - old_predecessor_list[block].begin()]);
+			}
+			argument_list = std::move(new_argument_list);
+		}
+	}
+}
+
+vector<uint> FuncIR::GetReversePostOrder() const {
+	vector<uint> order; order.reserve(block_list.size());
+	vector<bool> is_visited(block_list.size(), false);
+	vector<std::pair<uint, vector<uint>>> stack;  // (block, successors not visited yet)
+	is_visited[0] = true; stack.push_back({ 0, block_list[0].GetSuccessorList() });
+	while (!stack.empty()) {
+		auto& [block, successor_list] = stack.back();
+		if (successor_list.empty()) { order.push_back(block); stack.pop_back(); continue; }
+		uint successor = successor_list.back(); successor_list.pop_back();
+		if (!is_visited[successor]) {
+			is_visited[successor] = true;
+			stack.push_back({ successor, block_list[successor].GetSuccessorList() });
+		}
+	}
+	std::reverse(order.begin(), order.end());
+	return order;
+}
+
+void FuncIR::RemoveUnreachableBlock() {
+	vector<uint> order = GetReversePostOrder();
+	vector<bool> is_reachable(block_list.size(), false);
+	for (uint block : order) { is_reachable[block] = true; }
+	vector<uint> new_index(block_list.size(), -1); uint block_count = 0;
+	for (uint block = 0; block < block_list.size(); ++block) {
+		if (!is_reachable[block]) { continue; }
+		if (block != block_count) { block_list[block_count] = std::move(block_list[block]); }
+		new_index[block] = block_count++;
+	}
+	block_list.resize(block_count);
+	for (IRBlock& ir_block : block_list) {
+		if (ir_block.target != -1) { ir_block.target = new_index[ir_block.target]; }
+		if (ir_block.next != -1) { ir_block.next = new_index[ir_block.next]; }
+		for (uint& predecessor : ir_block.predecessor_list) { predecessor = new_index[predecessor]; }  // -1 if removed
+	}
+	UpdatePredecessor();
+}
+
+void FuncIR::RemoveEmptyBlock() {
+	assert(!is_ssa);
+	auto GetTarget = [&](uint block) {
+		for (uint count = 0; block != 0 && count < block_list.size(); ++count) {
+			if (!block_list[block].instr_list.empty() || block_list[block].exit_type != IRExitType::Goto) { break; }
+			block = block_list[block].target;
+		}
+		return block;
+	};
+	for (IRBlock& ir_block : block_list) {
+		if (ir_block.target != -1) { ir_block.target = GetTarget(ir_block.target); }
+		if (ir_block.next != -1) { ir_block.next = GetTarget(ir_block.next); }
+		if (ir_block.exit_type == IRExitType::JumpIf && ir_block.target == ir_block.next) { ir_block.SetGoto(ir_block.target); }
+	}
+	RemoveUnreachableBlock();
+}
+
+IRDefUse FuncIR::GetDefUse() const {
+	IRDefUse def_use{ vector<vector<IRSite>>(GetRegCount()), vector<vector<IRSite>>(GetRegCount()) };
+	for (uint block = 0; block < block_list.size(); ++block) {
+		const IRBlock& ir_block = block_list[block];
+		for (uint index = 0; index < ir_block.instr_list.size(); ++index) {
+			const IRInstr& instr = ir_block.instr_list[index];
+			instr.ForEachSrc([&](const IROperand& src) { if (src.IsReg()) { def_use.use_list[src.GetReg()].push_back({ block, index }); } });
+			if (instr.HasDest() && instr.GetDest().IsReg()) { def_use.def_list[instr.GetDest().GetReg()].push_back({ block, index }); }
+		}
+		uint exit_index = (uint)ir_block.instr_list.size();
+		ir_block.ForEachExitSrc([&](const IROperand& src) { if (src.IsReg()) { def_use.use_list[src.GetReg()].push_back({ block, exit_index }); } });
+	}
+	return def_use;
+}
\ No newline at end of file
@@ -0,0 +1,198 @@
+#pragma once
+
+#include "linear_code.h"
+
+#include <vector>
+
+
+using std::vector;
+
+
+enum class IROperandType : uchar { Empty, Number, Reg, Local, Global };
+
+// Scalar local variables and temporaries are registers, which are assigned to local slots when lowered.
+//   Local and Global operands are memory: a scalar variable as a value or destination,
+//   or the begin of an array as the base of Addr, Load and Store.
+struct IROperand {
+	IROperandType type = IROperandType::Empty;
+	int value = 0;
+
+public:
+	static IROperand Number(int value) { return IROperand{ IROperandType::Number, value }; }
+	static IROperand Reg(uint reg) { return IROperand{ IROperandType::Reg, (int)reg }; }
+	static IROperand Local(uint index) { return IROperand{ IROperandType::Local, (int)index }; }
+	static IROperand Global(uint index) { return IROperand{ IROperandType::Global, (int)index }; }
+public:
+	bool IsEmpty() const { return type == IROperandType::Empty; }
+	bool IsNumber() const { return type == IROperandType::Number; }
+	bool IsNumber(int number) const { return type == IROperandType::Number && value == number; }
+	bool IsReg() const { return type == IROperandType::Reg; }
+	bool IsReg(uint reg) const { return type == IROperandType::Reg && value == (int)reg; }
+	bool IsMemory() const { return type == IROperandType::Local || type == IROperandType::Global; }
+	uint GetReg() const { assert(IsReg()); return (uint)value; }
+public:
+	bool operator==(const IROperand& other) const { return type == other.type && value == other.value; }
+	bool operator!=(const IROperand& other) const { return !(*this == other); }
+};
+
+
+enum class IRInstrType : uchar {
+	BinaryOp,	//	x0 = x1 op x2
+	UnaryOp,	//	x0 = op x1
+	Copy,		//	x0 = x1
+	Addr,		//	x0 = &x1[x2]
+	Load,		//	x0 = x1[x2]
+	Store,		//	x0[x1] = x2
+	Call,		//	x0 = f(arguments), x0 is empty for a void call
+	Phi,		//	x0 = phi(arguments), an argument for each predecessor in order, only at the begin of a block in SSA form
+	Fill,		//	x0[0, x1) = x2, x1 is a number
+	MemCopy,	//	x0[0, x1) = x2[0, x1), x1 is a number
+};
+
+
+struct IRInstr {
+public:
+	IRInstrType type;
+	OperatorType op = OperatorType::None;
+	IROperand var[3];
+	uint func_index = 0;
+	vector<IROperand> argument_list;
+
+public:
+	static IRInstr BinaryOp(OperatorType op, IROperand dest, IROperand src1, IROperand src2) {
+		return IRInstr{ IRInstrType::BinaryOp, op, { dest, src1, src2 } };
+	}
+	static IRInstr UnaryOp(OperatorType op, IROperand dest, IROperand src) {
+		return IRInstr{ IRInstrType::UnaryOp, op, { dest, src } };
+	}
+	static IRInstr Copy(IROperand dest, IROperand src) {
+		return IRInstr{ IRInstrType::Copy, OperatorType::None, { dest, src } };
+	}
+	static IRInstr Addr(IROperand dest, IROperand src_begin, IROperand src_offset) {
+		return IRInstr{ IRInstrType::Addr, OperatorType::None, { dest, src_begin, src_offset } };
+	}
+	static IRInstr Load(IROperand dest, IROperand src_begin, IROperand src_offset) {
+		return IRInstr{ IRInstrType::Load, OperatorType::None, { dest, src_begin, src_offset } };
+	}
+	static IRInstr Store(IROperand dest_begin, IROperand dest_offset, IROperand src) {
+		return IRInstr{ IRInstrType::Store, OperatorType::None, { dest_begin, dest_offset, src } };
+	}
+	static IRInstr Call(uint func_index, IROperand dest, vector<IROperand> argument_list) {
+		return IRInstr{ IRInstrType::Call, OperatorType::None, { dest }, func_index, std::move(argument_list) };
+	}
+	static IRInstr Phi(IROperand dest, vector<IROperand> argument_list) {
+		return IRInstr{ IRInstrType::Phi, OperatorType::None, { dest }, 0, std::move(argument_list) };
+	}
+	static IRInstr Fill(IROperand dest_begin, IROperand length, IROperand src) {
+		return IRInstr{ IRInstrType::Fill, OperatorType::None, { dest_begin, length, src } };
+	}
+	static IRInstr MemCopy(IROperand dest_begin, IROperand length, IROperand src_begin) {
+		return IRInstr{ IRInstrType::MemCopy, OperatorType::None, { dest_begin, length, src_begin } };
+	}
+
+public:
+	bool IsMemoryWrite() const { return type == IRInstrType::Store || type == IRInstrType::Fill || type == IRInstrType::MemCopy; }  // x0 is a base
+	bool HasDest() const { return !IsMemoryWrite() && !var[0].IsEmpty(); }
+	IROperand& GetDest() { assert(HasDest()); return var[0]; }
+	const IROperand& GetDest() const { assert(HasDest()); return var[0]; }
+	bool IsBase(uint index) const {
+		return ((type == IRInstrType::Addr || type == IRInstrType::Load) && index == 1) || (IsMemoryWrite() && index == 0) ||
+			(type == IRInstrType::MemCopy && index == 2);
+	}
+	template<class Func>
+	void ForEachSrc(Func func) {  // including bases and arguments
+		switch (type) {
+		case IRInstrType::BinaryOp: case IRInstrType::Addr: case IRInstrType::Load: func(var[1]); func(var[2]); break;
+		case IRInstrType::UnaryOp: case IRInstrType::Copy: func(var[1]); break;
+		case IRInstrType::Store: case IRInstrType::Fill: case IRInstrType::MemCopy: func(var[0]); func(var[1]); func(var[2]); break;
+		case IRInstrType::Call: case IRInstrType::Phi: for (auto& argument : argument_list) { func(argument); } break;
+		default: assert(false); break;
+		}
+	}
+	template<class Func>
+	void ForEachSrc(Func func) const { const_cast<IRInstr&>(*this).ForEachSrc([&](const IROperand& src) { func(src); }); }
+};
+
+
+enum class IRExitType : uchar {
+	Goto,		//	goto target
+	JumpIf,		//	goto target if x0 op x1, else goto next
+	Return,		//	return x0, x0 is empty for a void return
+};
+
+
+struct IRBlock {
+public:
+	vector<IRInstr> instr_list;
+	IRExitType exit_type = IRExitType::Return;
+	OperatorType exit_op = OperatorType::None;
+	IROperand exit_var[2];
+	uint target = -1;
+	uint next = -1;
+	vector<uint> predecessor_list;  // updated by FuncIR::UpdatePredecessor, in the order of blocks
+
+public:
+	uint GetPhiCount() const {
+		uint count = 0; while (count < instr_list.size() && instr_list[count].type == IRInstrType::Phi) { count++; }
+		return count;
+	}
+	vector<uint> GetSuccessorList() const {
+		switch (exit_type) {
+		case IRExitType::Goto: return { target };
+		case IRExitType::JumpIf: return target == next ? vector<uint>{ target } : vector<uint>{ target, next };
+		default: return {};
+		}
+	}
+	template<class Func>
+	void ForEachExitSrc(Func func) {
+		if (exit_type == IRExitType::JumpIf) { func(exit_var[0]); func(exit_var[1]); }
+		if (exit_type == IRExitType::Return && !exit_var[0].IsEmpty()) { func(exit_var[0]); }
+	}
+	template<class Func>
+	void ForEachExitSrc(Func func) const { const_cast<IRBlock&>(*this).ForEachExitSrc([&](const IROperand& src) { func(src); }); }
+	void SetGoto(uint target) { exit_type = IRExitType::Goto; exit_op = OperatorType::None; exit_var[0] = exit_var[1] = {}; this->target = target; next = -1; }
+};
+
+
+// The position of an instruction, index == instr_list.size() for the exit of the block.
+struct IRSite {
+	uint block;
+	uint index;
+};
+
+struct IRDefUse {
+	vector<vector<IRSite>> def_list;  // of each register
+	vector<vector<IRSite>> use_list;  // a site is listed once for each use
+};
+
+
+// A mutable form of GlobalFuncDef as a control flow graph of basic blocks, lowered back after transformed.
+class FuncIR {
+public:
+	const uint parameter_count;
+	const bool is_int;
+	vector<IRBlock> block_list;  // the entry is the first block, which has no predecessor
+	vector<bool> reg_is_pointer;  // pointers are only copied, used as the base of Addr, Load, Store, or as arguments
+	vector<uint> parameter_reg;  // the register of each parameter at entry, assigned to its parameter slot
+	bool is_ssa = false;
+	uint memory_length;  // local slots below are kept for memory operands, registers are assigned to slots above
+	LocalArrayList local_array_list;  // sorted and disjoint, overlapping arrays are merged
+
+public:
+	FuncIR(const GlobalFuncDef& func_def);
+	GlobalFuncDef Lower() const;
+
+public:
+	uint GetRegCount() const { return (uint)reg_is_pointer.size(); }
+	uint AllocateReg(bool is_pointer) { reg_is_pointer.push_back(is_pointer); return GetRegCount() - 1; }
+	uint GetLocalArray(uint slot) const;  // the index in local_array_list of the array containing the slot, -1 if none
+
+public:
+	// Arguments of phis are kept for remaining predecessors. A new predecessor of a block with phis
+	//   must have been appended to its predecessor list, with the arguments appended to the phis.
+	void UpdatePredecessor();
+	vector<uint> GetReversePostOrder() const;  // of blocks reachable from the entry
+	void RemoveUnreachableBlock();  // also updates predecessors
+	void RemoveEmptyBlock();  // jumps to blocks with only a goto go to their targets, out of SSA form
+	IRDefUse GetDefUse() const;
+};
\ No newline at end of file
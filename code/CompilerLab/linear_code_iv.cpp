@@ -0,0 +1,209 @@
+#include "linear_code_iv.h"
+#include "linear_code_loop.h"
+
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+
+namespace {
+
+struct BasicInductionVariable {
+	IROperand init;  // the argument from the preheader
+	uint next;  // the argument of all back edges
+	IROperand step;  // a number or an invariant register
+};
+
+// a * iv + reg + number, where iv is a basic induction variable unless a is 0, and reg is an invariant register or empty.
+struct AffineValue {
+	bool is_valid = false;
+	uint iv = -1;
+	int a = 0;
+	IROperand reg;
+	int number = 0;
+
+public:
+	static AffineValue Invariant(IROperand reg, int number) { return AffineValue{ true, (uint)-1, 0, reg, number }; }
+	static AffineValue Combine(const AffineValue& left, const AffineValue& right, int sign) {
+		if (!left.is_valid || !right.is_valid) { return {}; }
+		if (left.iv != -1 && right.iv != -1 && left.iv != right.iv) { return {}; }
+		if (!right.reg.IsEmpty() && (!left.reg.IsEmpty() || sign < 0)) { return {}; }
+		AffineValue value{ true, left.iv != -1 ? left.iv : right.iv };
+		value.a = (int)((uint)left.a + (uint)sign * (uint)right.a);
+		value.reg = left.reg.IsEmpty() ? right.reg : left.reg;
+		value.number = (int)((uint)left.number + (uint)sign * (uint)right.number);
+		if (value.a == 0) { value.iv = -1; }
+		return value;
+	}
+	static AffineValue Scale(AffineValue value, int factor) {
+		if (!value.is_valid || (!value.reg.IsEmpty() && factor != 1)) { return {}; }
+		value.a = (int)((uint)value.a * (uint)factor);
+		value.number = (int)((uint)value.number * (uint)factor);
+		if (value.a == 0) { value.iv = -1; }
+		return value;
+	}
+};
+
+
+class InductionVariableReducer {
+private:
+	FuncIR& func_ir;
+	vector<IRBlock>& block_list;
+	LoopForest loop_forest;
+	vector<IRSite> def_site;  // block -1 for registers defined at entry
+private:
+	uint loop = -1;
+	std::unordered_map<uint, BasicInductionVariable> basic_iv;  // of the current loop, by the phi
+	std::unordered_map<uint, AffineValue> affine_cache;
+
+public:
+	InductionVariableReducer(FuncIR& func_ir, const DominatorTree& dominator_tree) :
+		func_ir(func_ir), block_list(func_ir.block_list), loop_forest(func_ir, dominator_tree) {
+		loop_forest.InsertPreheader(func_ir);
+	}
+
+private:
+	bool IsInLoop(uint reg) const { return def_site[reg].block != -1 && loop_forest.Contains(loop, def_site[reg].block); }
+	bool IsInvariant(const IROperand& operand) const { return operand.IsNumber() || (operand.IsReg() && !IsInLoop(operand.GetReg())); }
+	const IRInstr& GetDef(uint reg) const { return block_list[def_site[reg].block].instr_list[def_site[reg].index]; }
+	void UpdateDefSite();
+	void FindBasicInductionVariable();
+	AffineValue GetAffine(const IROperand& operand);
+	IROperand AppendBinaryOp(vector<IRInstr>& instr_list, OperatorType op, IROperand left, IROperand right);  // folds numbers
+	void ReduceLoop();
+public:
+	void Run() { for (loop = 0; loop < loop_forest.loop_list.size(); ++loop) { ReduceLoop(); } }
+};
+
+void InductionVariableReducer::UpdateDefSite() {
+	def_site.assign(func_ir.GetRegCount(), IRSite{ (uint)-1, (uint)-1 });
+	for (uint block = 0; block < block_list.size(); ++block) {
+		for (uint index = 0; index < block_list[block].instr_list.size(); ++index) {
+			const IRInstr& instr = block_list[block].instr_list[index];
+			if (instr.HasDest() && instr.GetDest().IsReg()) { def_site[instr.GetDest().GetReg()] = { block, index }; }
+		}
+	}
+}
+
+void InductionVariableReducer::FindBasicInductionVariable() {
+	basic_iv.clear(); affine_cache.clear();
+	const IRLoop& ir_loop = loop_forest.loop_list[loop];
+	const IRBlock& header = block_list[ir_loop.header];
+	for (uint index = 0; index < header.GetPhiCount(); ++index) {
+		const IRInstr& phi = header.instr_list[index];
+		uint reg = phi.GetDest().GetReg();
+		BasicInductionVariable iv{ {}, (uint)-1 };
+		bool is_valid = true;
+		for (uint k = 0; k < header.predecessor_list.size(); ++k) {
+			const IROperand& argument = phi.argument_list[k];
+			if (header.predecessor_list[k] == ir_loop.preheader) { iv.init = argument; continue; }
+			if (!argument.IsReg() || (iv.next != -1 && iv.next != argument.GetReg())) { is_valid = false; break; }
+			iv.next = argument.GetReg();
+		}
+		if (!is_valid || iv.next == -1 || !IsInLoop(iv.next) || GetDef(iv.next).type != IRInstrType::BinaryOp) { continue; }
+		const IRInstr& increment = GetDef(iv.next);
+		if (increment.op == OperatorType::Add) {
+			if (increment.var[1].IsReg(reg)) { iv.step = increment.var[2]; } else if (increment.var[2].IsReg(reg)) { iv.step = increment.var[1]; }
+		} else if (increment.op == OperatorType::Sub && increment.var[1].IsReg(reg) && increment.var[2].IsNumber()) {
+			iv.step = IROperand::Number((int)(0u - (uint)increment.var[2].value));
+		}
+		if (iv.step.IsEmpty() || !IsInvariant(iv.step)) { continue; }
+		basic_iv.emplace(reg, iv);
+	}
+}
+
+AffineValue InductionVariableReducer::GetAffine(const IROperand& operand) {
+	if (operand.IsNumber()) { return AffineValue::Invariant({}, operand.value); }
+	if (!operand.IsReg()) { return {}; }
+	uint reg = operand.GetReg();
+	if (!IsInLoop(reg)) { return AffineValue::Invariant(operand, 0); }
+	if (basic_iv.count(reg)) { return AffineValue{ true, reg, 1 }; }
+	if (auto it = affine_cache.find(reg); it != affine_cache.end()) { return it->second; }
+	affine_cache[reg] = {};  // for cycles
+	const IRInstr& instr = GetDef(reg);
+	AffineValue value;
+	if (instr.type == IRInstrType::Copy) {
+		value = GetAffine(instr.var[1]);
+	} else if (instr.type == IRInstrType::BinaryOp) {
+		switch (instr.op) {
+		case OperatorType::Add: value = AffineValue::Combine(GetAffine(instr.var[1]), GetAffine(instr.var[2]), 1); break;
+		case OperatorType::Sub: value = AffineValue::Combine(GetAffine(instr.var[1]), GetAffine(instr.var[2]), -1); break;
+		case OperatorType::Mul:
+			if (instr.var[2].IsNumber()) { value = AffineValue::Scale(GetAffine(instr.var[1]), instr.var[2].value); }
+			else if (instr.var[1].IsNumber()) { value = AffineValue::Scale(GetAffine(instr.var[2]), instr.var[1].value); }
+			break;
+		default: break;
+		}
+	}
+	return affine_cache[reg] = value;
+}
+
+IROperand InductionVariableReducer::AppendBinaryOp(vector<IRInstr>& instr_list, OperatorType op, IROperand left, IROperand right) {
+	if ((op == OperatorType::Add && right.IsNumber(0)) || (op == OperatorType::Mul && right.IsNumber(1))) { return left; }
+	int result;
+	if (left.IsNumber() && right.IsNumber() && EvalBinaryOperatorAsRuntime(op, left.value, right.value, result)) { return IROperand::Number(result); }
+	uint reg = func_ir.AllocateReg(false);
+	instr_list.push_back(IRInstr::BinaryOp(op, IROperand::Reg(reg), left, right));
+	return IROperand::Reg(reg);
+}
+
+void InductionVariableReducer::ReduceLoop() {
+	UpdateDefSite();
+	FindBasicInductionVariable();
+	if (basic_iv.empty()) { return; }
+	const IRLoop& ir_loop = loop_forest.loop_list[loop];
+	vector<IRInstr>& preheader_instr_list = block_list[ir_loop.preheader].instr_list;
+	const vector<uint>& header_predecessor_list = block_list[ir_loop.header].predecessor_list;
+
+	// addresses with the same base and offset share a pointer
+	std::map<std::tuple<IROperandType, int, uint, int, IROperandType, int, int>, uint> pointer_map;
+	vector<IRInstr> phi_list;
+	vector<std::pair<uint, IRInstr>> increment_list;  // at the end of latches, where the pointers are no longer used
+	for (uint block : ir_loop.block_list) {
+		for (IRInstr& instr : block_list[block].instr_list) {
+			if (instr.type != IRInstrType::Addr || !instr.var[2].IsReg() || !IsInLoop(instr.var[2].GetReg())) { continue; }
+			const IROperand base = instr.var[1];
+			if (!base.IsMemory() && !IsInvariant(base)) { continue; }
+			AffineValue value = GetAffine(instr.var[2]);
+			if (!value.is_valid || value.iv == -1 || instr.var[2].IsReg(value.iv)) { continue; }
+			auto key = std::make_tuple(base.type, base.value, value.iv, value.a, value.reg.type, value.reg.value, value.number);
+			auto it = pointer_map.find(key);
+			if (it == pointer_map.end()) {
+				const BasicInductionVariable& iv = basic_iv.at(value.iv);
+				IROperand offset = AppendBinaryOp(preheader_instr_list, OperatorType::Mul, iv.init, IROperand::Number(value.a));
+				if (!value.reg.IsEmpty()) { offset = AppendBinaryOp(preheader_instr_list, OperatorType::Add, offset, value.reg); }
+				offset = AppendBinaryOp(preheader_instr_list, OperatorType::Add, offset, IROperand::Number(value.number));
+				IROperand pointer_begin = base;
+				if (!base.IsReg() || !offset.IsNumber(0)) {
+					pointer_begin = IROperand::Reg(func_ir.AllocateReg(true));
+					preheader_instr_list.push_back(IRInstr::Addr(pointer_begin, base, offset));
+				}
+				IROperand step = AppendBinaryOp(preheader_instr_list, OperatorType::Mul, iv.step, IROperand::Number(value.a));
+				uint pointer = func_ir.AllocateReg(true);
+				vector<IROperand> argument_list;
+				for (uint predecessor : header_predecessor_list) {
+					if (predecessor == ir_loop.preheader) { argument_list.push_back(pointer_begin); continue; }
+					uint pointer_next = func_ir.AllocateReg(true);
+					argument_list.push_back(IROperand::Reg(pointer_next));
+					increment_list.push_back({ predecessor, IRInstr::Addr(IROperand::Reg(pointer_next), IROperand::Reg(pointer), step) });
+				}
+				phi_list.push_back(IRInstr::Phi(IROperand::Reg(pointer), std::move(argument_list)));
+				it = pointer_map.emplace(key, pointer).first;
+			}
+			instr = IRInstr::Copy(instr.var[0], IROperand::Reg(it->second));
+		}
+	}
+
+	vector<IRInstr>& header_instr_list = block_list[ir_loop.header].instr_list;
+	header_instr_list.insert(header_instr_list.begin(), phi_list.begin(), phi_list.end());
+	for (auto& [latch, increment] : increment_list) { block_list[latch].instr_list.push_back(std::move(increment)); }
+}
+
+} // namespace
+
+
+void ReduceInductionVariable(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	func_ir.RemoveUnreachableBlock();
+	InductionVariableReducer(func_ir, DominatorTree(func_ir)).Run();
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Strength reduction of array addressing over a FuncIR in SSA form. A basic induction variable is a phi at
+//   a loop header, increased by the same invariant step on every back edge. An address &base[a * i + b] of an
+//   induction variable i, with an invariant base, a constant a and an invariant b, becomes a pointer phi
+//   increased by a * step at the end of each latch, so the multiplies and adds of the offset are left dead.
+void ReduceInductionVariable(FuncIR& func_ir);
\ No newline at end of file
@@ -0,0 +1,483 @@
+#include "linear_code_jit.h"
+
+#ifdef LINEAR_CODE_JIT
+
+#include "library_function.h"
+
+#include <cstddef>
+#include <cstring>
+#include <sys/mman.h>
+#include <unistd.h>
+
+
+// Register assignment of the generated code, the frame registers are callee-saved in the System V ABI.
+//   rbx: the current frame, r12: the variable stack, r13: the context, r14: the frame pointer as an index.
+//   rax, rcx, rdx, rsi and rdi are scratch registers.
+constexpr X86Reg rax = X86Reg::rax, rcx = X86Reg::rcx, rdx = X86Reg::rdx, rbx = X86Reg::rbx;
+constexpr X86Reg rsp = X86Reg::rsp, rbp = X86Reg::rbp, rsi = X86Reg::rsi, rdi = X86Reg::rdi;
+constexpr X86Reg r12 = X86Reg::r12, r13 = X86Reg::r13, r14 = X86Reg::r14, r15 = X86Reg::r15;
+constexpr X86Reg frame_base = rbx, stack_base = r12, context_reg = r13, frame_index = r14;
+
+#define JIT_CONTEXT_FIELD(field) X86Mem(context_reg, (int)offsetof(JitContext, field))
+
+// stack space kept below the limit for the callbacks to the host
+constexpr uint64 native_stack_reserved_size = 1 << 18;
+
+
+inline X86Cond GetComparisonCond(OperatorType op) {
+	switch (op) {
+	case OperatorType::Equal: return X86Cond::E;
+	case OperatorType::NotEqual: return X86Cond::NE;
+	case OperatorType::Less: return X86Cond::L;
+	case OperatorType::Greater: return X86Cond::G;
+	case OperatorType::LessEqual: return X86Cond::LE;
+	case OperatorType::GreaterEuqal: return X86Cond::GE;
+	default: assert(false); return X86Cond::E;
+	}
+}
+
+
+LinearCodeJit::LinearCodeJit(JitContext& context, const GlobalFuncTable& global_func_table, Option option) :
+	context(context), global_func_table(global_func_table), option(option),
+	func_code_table(global_func_table.size()), func_entry_table(global_func_table.size()) {
+	assert(option.native_stack_size > native_stack_reserved_size);
+	void* stack = mmap(nullptr, option.native_stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+	if (stack == MAP_FAILED) { throw std::runtime_error("failed to allocate the native stack"); }
+	native_stack = (char*)stack;
+	context.native_stack_begin = native_stack;
+	context.native_stack_size = option.native_stack_size;
+	context.native_stack_limit = native_stack + native_stack_reserved_size;
+	context.func_entry_table = func_entry_table.data();
+	GenerateStubs();
+}
+
+LinearCodeJit::~LinearCodeJit() {
+	for (auto& code_memory : code_memory_list) { munmap(code_memory.addr, code_memory.size); }
+	munmap(native_stack, option.native_stack_size);
+}
+
+ref_ptr<const uchar> LinearCodeJit::CommitCode(const vector<uchar>& code) {
+	size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+	size_t size = (code.size() + page_size - 1) / page_size * page_size;
+	void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (addr == MAP_FAILED) { return nullptr; }
+	memcpy(addr, code.data(), code.size());
+	if (mprotect(addr, size, PROT_READ | PROT_EXEC) != 0) { munmap(addr, size); return nullptr; }
+	code_memory_list.push_back(CodeMemory{ addr, size });
+	return (const uchar*)addr;
+}
+
+void LinearCodeJit::GenerateStubs() {
+	X86Assembler stub;
+
+	// int enter_func(JitContext* context, const void* code, const void* target)
+	stub.Push(rbp); stub.MovRegReg(rbp, rsp, true);
+	stub.Push(rbx); stub.Push(r12); stub.Push(r13); stub.Push(r14); stub.Push(r15);
+	stub.AluRegImm(X86AluOp::Sub, rsp, 8, true);
+	stub.MovRegReg(context_reg, rdi, true);
+	X86Assembler::Label on_native_stack = stub.NewLabel();
+	stub.MovRegReg(rax, rsp, true);
+	stub.AluRegMem(X86AluOp::Sub, rax, JIT_CONTEXT_FIELD(native_stack_begin), true);
+	stub.AluRegMem(X86AluOp::Cmp, rax, JIT_CONTEXT_FIELD(native_stack_size), true);
+	stub.Jcc(X86Cond::B, on_native_stack);  // entered again from a callback
+	stub.MovRegMem(rsp, JIT_CONTEXT_FIELD(native_stack_begin), true);
+	stub.AluRegMem(X86AluOp::Add, rsp, JIT_CONTEXT_FIELD(native_stack_size), true);
+	stub.Bind(on_native_stack);
+	stub.MovRegReg(rax, rsi, true);
+	stub.MovRegReg(rsi, rdx, true);
+	stub.CallReg(rax);
+	stub.Lea(rsp, X86Mem(rbp, -40));
+	stub.Pop(r15); stub.Pop(r14); stub.Pop(r13); stub.Pop(r12); stub.Pop(rbx); stub.Pop(rbp);
+	stub.Ret();
+
+	// functions not compiled yet are called through a stub calling back the interpreter
+	vector<uint> stub_offset;
+	for (uint func_index = 0; func_index < global_func_table.size(); ++func_index) {
+		stub_offset.push_back(stub.GetSize());
+		stub.AluRegImm(X86AluOp::Sub, rsp, 8, true);
+		stub.MovRegReg(rdi, context_reg, true);
+		stub.MovRegImm(rsi, (int)func_index);
+		stub.CallMem(JIT_CONTEXT_FIELD(call_interpreted));
+		stub.AluRegImm(X86AluOp::Add, rsp, 8, true);
+		stub.Ret();
+	}
+
+	stub.ResolveLabels();
+	const uchar* code = CommitCode(stub.GetCode());
+	if (code == nullptr) { throw std::runtime_error("failed to allocate executable memory"); }
+	enter_func = (EnterFuncPtr)code;
+	for (uint func_index = 0; func_index < global_func_table.size(); ++func_index) {
+		func_entry_table[func_index] = code + stub_offset[func_index];
+	}
+}
+
+
+X86Mem LinearCodeJit::GetVarMem(VarInfo var, int offset) {
+	uint64 disp = ((uint64)(uint)var.value + (uint64)(uint)offset) * 4;
+	if (disp > 0x7FFFFFFF) { is_unsupported = true; disp = 0; }
+	switch (var.type) {
+	case VarType::Local: case VarType::Addr: return X86Mem(frame_base, (int)disp);
+	case VarType::Global: return X86Mem(stack_base, (int)disp);
+	default: assert(false); return X86Mem(frame_base);
+	}
+}
+
+void LinearCodeJit::LoadValueVar(X86Reg reg, VarInfo var) {
+	if (var.type == VarType::Number) { return assembler.MovRegImm(reg, var.value); }
+	assembler.MovRegMem(reg, GetVarMem(var));
+}
+
+void LinearCodeJit::StoreValueVar(VarInfo var, X86Reg reg) {
+	assert(var.IsRefOrAddr());
+	assembler.MovMemReg(GetVarMem(var), reg);
+}
+
+// the index of var[offset] in the variable stack
+void LinearCodeJit::LoadAddrVar(X86Reg reg, VarInfo var, VarInfo offset) {
+	LoadValueVar(reg, offset);
+	switch (var.type) {
+	case VarType::Local:
+		assembler.AluRegReg(X86AluOp::Add, reg, frame_index);
+		assembler.AluRegImm(X86AluOp::Add, reg, var.value);
+		break;
+	case VarType::Global: assembler.AluRegImm(X86AluOp::Add, reg, var.value); break;
+	case VarType::Addr: assembler.AluRegMem(X86AluOp::Add, reg, GetVarMem(var)); break;
+	default: assert(false); break;
+	}
+}
+
+void LinearCodeJit::CheckAddr(X86Reg reg) {
+	if (!option.check_indirect_access) { return; }
+	assembler.AluRegMem(X86AluOp::Cmp, reg, JIT_CONTEXT_FIELD(stack_top));
+	assembler.Jcc(X86Cond::AE, subscript_out_of_range_label);
+}
+
+// the machine address of var[0] for the range var[0, length), checked with rdx if var holds an address
+void LinearCodeJit::LoadRangeAddr(X86Reg reg, VarInfo var, int length) {
+	if (var.IsRef()) { return assembler.Lea(reg, GetVarMem(var)); }
+	assembler.MovRegMem(reg, GetVarMem(var));
+	if (option.check_indirect_access) {
+		assembler.MovRegMem(rdx, JIT_CONTEXT_FIELD(stack_top));
+		assembler.AluRegImm(X86AluOp::Sub, rdx, length, true);
+		assembler.AluRegReg(X86AluOp::Cmp, reg, rdx, true);
+		assembler.Jcc(X86Cond::G, subscript_out_of_range_label);
+	}
+	assembler.Lea(reg, X86Mem(stack_base, reg, 2));
+}
+
+// the variable stack may have been moved by a call
+void LinearCodeJit::ReloadFrameBase() {
+	assembler.MovRegMem(stack_base, JIT_CONTEXT_FIELD(stack_base), true);
+	assembler.Lea(frame_base, X86Mem(stack_base, frame_index, 2));
+}
+
+void LinearCodeJit::ReadPrologue() {
+	assembler.Push(rbx); assembler.Push(r12); assembler.Push(r14);
+	assembler.AluRegMem(X86AluOp::Cmp, rsp, JIT_CONTEXT_FIELD(native_stack_limit), true);
+	assembler.Jcc(X86Cond::B, stack_overflow_label);
+	assembler.MovRegMem(frame_index, JIT_CONTEXT_FIELD(frame_pointer));
+	ReloadFrameBase();
+}
+
+void LinearCodeJit::ReadEpilogue() {
+	assembler.Pop(r14); assembler.Pop(r12); assembler.Pop(rbx);
+	assembler.Ret();
+}
+
+void LinearCodeJit::ReadBinaryOp(const CodeLine& line) {
+	VarInfo dest(line, 0), src1(line, 1), src2(line, 2);
+	auto AluSrc2 = [&](X86AluOp op) {
+		if (src2.type == VarType::Number) { assembler.AluRegImm(op, rax, src2.value); } else { assembler.AluRegMem(op, rax, GetVarMem(src2)); }
+	};
+	LoadValueVar(rax, src1);
+	switch (line.op) {
+	case OperatorType::Add: AluSrc2(X86AluOp::Add); break;
+	case OperatorType::Sub: AluSrc2(X86AluOp::Sub); break;
+	case OperatorType::Mul:
+		if (src2.type == VarType::Number) { assembler.ImulRegRegImm(rax, rax, src2.value); } else { assembler.ImulRegMem(rax, GetVarMem(src2)); }
+		break;
+	case OperatorType::Div:
+	case OperatorType::Mod:
+		LoadValueVar(rcx, src2);
+		assembler.Cdq(); assembler.Idiv(rcx);
+		if (line.op == OperatorType::Mod) { assembler.MovRegReg(rax, rdx); }
+		break;
+	case OperatorType::And:
+	case OperatorType::Or:
+		assembler.Test(rax, rax); assembler.SetccZeroExtend(X86Cond::NE, rax);
+		LoadValueVar(rcx, src2);
+		assembler.Test(rcx, rcx); assembler.SetccZeroExtend(X86Cond::NE, rcx);
+		assembler.AluRegReg(line.op == OperatorType::And ? X86AluOp::And : X86AluOp::Or, rax, rcx);
+		break;
+	default:
+		AluSrc2(X86AluOp::Cmp);
+		assembler.SetccZeroExtend(GetComparisonCond(line.op), rax);
+		break;
+	}
+	StoreValueVar(dest, rax);
+}
+
+void LinearCodeJit::ReadUnaryOp(const CodeLine& line) {
+	VarInfo dest(line, 0), src(line, 1);
+	LoadValueVar(rax, src);
+	switch (line.op) {
+	case OperatorType::Add: break;
+	case OperatorType::Sub: assembler.Neg(rax); break;
+	case OperatorType::Not: assembler.Test(rax, rax); assembler.SetccZeroExtend(X86Cond::E, rax); break;
+	default: assert(false); break;
+	}
+	StoreValueVar(dest, rax);
+}
+
+void LinearCodeJit::ReadAddr(const CodeLine& line) {
+	VarInfo dest(line, 0), base(line, 1), offset(line, 2);
+	LoadAddrVar(rax, base, offset);
+	StoreValueVar(dest, rax);
+}
+
+void LinearCodeJit::ReadLoad(const CodeLine& line) {
+	VarInfo dest(line, 0), base(line, 1), offset(line, 2);
+	if (offset.type == VarType::Number && base.IsRef()) {
+		assembler.MovRegMem(rax, GetVarMem(base, offset.value));
+	} else {
+		LoadAddrVar(rax, base, offset);
+		CheckAddr(rax);
+		assembler.MovRegMem(rax, X86Mem(stack_base, rax, 2));
+	}
+	StoreValueVar(dest, rax);
+}
+
+void LinearCodeJit::ReadStore(const CodeLine& line) {
+	VarInfo base(line, 0), offset(line, 1), src(line, 2);
+	auto StoreSrc = [&](const X86Mem& mem) {
+		if (src.type == VarType::Number) { return assembler.MovMemImm(mem, src.value); }
+		LoadValueVar(rcx, src);
+		assembler.MovMemReg(mem, rcx);
+	};
+	if (offset.type == VarType::Number && base.IsRef()) { return StoreSrc(GetVarMem(base, offset.value)); }
+	LoadAddrVar(rax, base, offset);
+	CheckAddr(rax);
+	StoreSrc(X86Mem(stack_base, rax, 2));
+}
+
+void LinearCodeJit::ReadFill(const CodeLine& line) {
+	VarInfo dest(line, 0), length(line, 1), src(line, 2);
+	LoadValueVar(rax, src);
+	LoadRangeAddr(rdi, dest, length.value);
+	assembler.MovRegImm(rcx, length.value);
+	assembler.RepStosd();
+}
+
+void LinearCodeJit::ReadMemCopy(const CodeLine& line) {
+	VarInfo dest(line, 0), length(line, 1), src(line, 2);
+	LoadRangeAddr(rsi, src, length.value);
+	LoadRangeAddr(rdi, dest, length.value);
+	assembler.MovRegImm(rcx, length.value);
+	assembler.RepMovsd();
+}
+
+// Library functions reading or writing a single value are called directly,
+//   the others are called back through the interpreter, as they may throw.
+void LinearCodeJit::ReadLibraryFuncCall(const CodeBlock& code_block, uint& line_no) {
+	uint func_index = code_block[line_no].var[0];
+	uint parameter_count = GetLibraryFuncParameterCount(func_index);
+	const void* func = nullptr;
+	switch ((LibraryFunc)func_index) {
+	case LibraryFunc::GetInt: func = (const void*)LibraryGetInt; break;
+	case LibraryFunc::GetCh: func = (const void*)LibraryGetCh; break;
+	case LibraryFunc::PutInt: func = (const void*)LibraryPutInt; break;
+	case LibraryFunc::PutCh: func = (const void*)LibraryPutCh; break;
+	default: break;
+	}
+	assert(parameter_count <= 2);
+	const X86Reg argument_reg[2] = { func != nullptr ? rdi : rdx, func != nullptr ? rsi : rcx };
+	for (uint i = 0; i < parameter_count; ++i) {
+		line_no++;
+		assert(line_no < code_block.size() && code_block[line_no].type == CodeLineType::Parameter);
+		LoadValueVar(argument_reg[i], VarInfo(code_block[line_no], 0));
+	}
+	if (func != nullptr) {
+		assembler.MovRegImm64(rax, (uint64)func);
+		assembler.CallReg(rax);
+		assembler.MovMemReg(JIT_CONTEXT_FIELD(return_value), rax);
+	} else {
+		assembler.MovRegReg(rdi, context_reg, true);
+		assembler.MovRegImm(rsi, (int)func_index);
+		assembler.CallMem(JIT_CONTEXT_FIELD(call_library));
+		assembler.Test(rax, rax);
+		assembler.Jcc(X86Cond::NE, exit_label);
+	}
+}
+
+// The callee frame is allocated above the current one and entered as LinearCodeInterpreter::EnterFunc does.
+void LinearCodeJit::ReadFuncCall(const CodeBlock& code_block, uint& line_no) {
+	const CodeLine& line = code_block[line_no];
+	uint func_index = line.var[0];
+	if (IsLibraryFunc(func_index)) {
+		ReadLibraryFuncCall(code_block, line_no);
+	} else {
+		func_index -= library_func_number;
+		const GlobalFuncDef& func_def = global_func_table[func_index];
+		if (func_def.local_var_length > 0x7FFFFFFF || func_index > 0x0FFFFFFF) { is_unsupported = true; }
+		X86Assembler::Label allocate = assembler.NewLabel(), allocated = assembler.NewLabel();
+		assembler.Bind(allocate);
+		assembler.MovRegMem(rax, JIT_CONTEXT_FIELD(stack_top));
+		assembler.Lea(rdx, X86Mem(rax, (int)func_def.local_var_length));
+		assembler.AluRegMem(X86AluOp::Cmp, rdx, JIT_CONTEXT_FIELD(stack_size), true);
+		assembler.Jcc(X86Cond::BE, allocated);
+		assembler.MovRegReg(rdi, context_reg, true);
+		assembler.MovRegReg(rsi, rdx, true);
+		assembler.CallMem(JIT_CONTEXT_FIELD(grow_stack));
+		assembler.Test(rax, rax);
+		assembler.Jcc(X86Cond::NE, exit_label);
+		ReloadFrameBase();
+		assembler.Jmp(allocate);
+		assembler.Bind(allocated);
+		assembler.Lea(rdi, X86Mem(stack_base, rax, 2));
+		for (uint i = 0; i < func_def.parameter_count; ++i) {
+			line_no++;
+			assert(line_no < code_block.size() && code_block[line_no].type == CodeLineType::Parameter);
+			VarInfo para(code_block[line_no], 0);
+			if (para.type == VarType::Number) {
+				assembler.MovMemImm(X86Mem(rdi, (int)i * 4), para.value);
+			} else {
+				LoadValueVar(rcx, para);
+				assembler.MovMemReg(X86Mem(rdi, (int)i * 4), rcx);
+			}
+		}
+		assembler.MovMemReg(JIT_CONTEXT_FIELD(frame_pointer), rax);
+		assembler.MovMemReg(JIT_CONTEXT_FIELD(stack_top), rdx);
+		assembler.MovMemImm(JIT_CONTEXT_FIELD(frame_size), (int)func_def.local_var_length);
+		if (option.poison_local_var && func_def.local_var_length > func_def.parameter_count) {
+			uint length = func_def.local_var_length - func_def.parameter_count;
+			if (length <= 8) {
+				for (uint i = func_def.parameter_count; i < func_def.local_var_length; ++i) {
+					assembler.MovMemImm(X86Mem(rdi, (int)i * 4), option.local_var_initial_value);
+				}
+			} else {
+				assembler.Lea(rdi, X86Mem(rdi, (int)func_def.parameter_count * 4));
+				assembler.MovRegImm(rcx, (int)length);
+				assembler.MovRegImm(rax, option.local_var_initial_value);
+				assembler.RepStosd();
+			}
+		}
+		assembler.MovRegMem(rax, JIT_CONTEXT_FIELD(func_entry_table), true);
+		assembler.CallMem(X86Mem(rax, (int)func_index * 8));
+		assembler.Test(rax, rax);
+		assembler.Jcc(X86Cond::NE, exit_label);
+		// the callee has reset stack_top to its frame pointer
+		assembler.MovMemReg(JIT_CONTEXT_FIELD(frame_pointer), frame_index);
+		assembler.MovMemImm(JIT_CONTEXT_FIELD(frame_size), (int)current_func_def->local_var_length);
+		ReloadFrameBase();
+	}
+	VarInfo dest(line, 1);
+	if (dest.IsRef()) {
+		assembler.MovRegMem(rax, JIT_CONTEXT_FIELD(return_value));
+		StoreValueVar(dest, rax);
+	}
+}
+
+void LinearCodeJit::ReadJumpIf(const CodeLine& line) {
+	VarInfo src1(line, 1), src2(line, 2);
+	uint label_index = line.var[0];
+	assert(label_index < current_func_def->label_map.size());
+	LoadValueVar(rax, src1);
+	if (src2.type == VarType::Number) { assembler.AluRegImm(X86AluOp::Cmp, rax, src2.value); } else { assembler.AluRegMem(X86AluOp::Cmp, rax, GetVarMem(src2)); }
+	assembler.Jcc(GetComparisonCond(line.op), line_label[current_func_def->label_map[label_index]]);
+}
+
+void LinearCodeJit::ReadReturn(const CodeLine& line) {
+	VarInfo var(line, 0);
+	if (var.IsIntOrRef()) {
+		LoadValueVar(rax, var);
+		assembler.MovMemReg(JIT_CONTEXT_FIELD(return_value), rax);
+	}
+	assembler.MovMemReg(JIT_CONTEXT_FIELD(stack_top), frame_index);
+	assembler.AluRegReg(X86AluOp::Xor, rax, rax);
+	ReadEpilogue();
+}
+
+void LinearCodeJit::ReadCodeLine(const CodeBlock& code_block, uint& line_no) {
+	const CodeLine& line = code_block[line_no];
+	switch (line.type) {
+	case CodeLineType::BinaryOp: ReadBinaryOp(line); break;
+	case CodeLineType::UnaryOp: ReadUnaryOp(line); break;
+	case CodeLineType::Addr: ReadAddr(line); break;
+	case CodeLineType::Load: ReadLoad(line); break;
+	case CodeLineType::Store: ReadStore(line); break;
+	case CodeLineType::Fill: ReadFill(line); break;
+	case CodeLineType::MemCopy: ReadMemCopy(line); break;
+	case CodeLineType::FuncCall: ReadFuncCall(code_block, line_no); break;
+	case CodeLineType::JumpIf: ReadJumpIf(line); break;
+	case CodeLineType::Goto:
+		assert((uint)line.var[0] < current_func_def->label_map.size());
+		assembler.Jmp(line_label[current_func_def->label_map[line.var[0]]]);
+		break;
+	case CodeLineType::Return: ReadReturn(line); break;
+	default: assert(false); break;
+	}
+}
+
+// The function is entered at offset 0, and resumed at the label in rsi after the second prologue at the end.
+void LinearCodeJit::ReadFuncDef(const GlobalFuncDef& func_def) {
+	const CodeBlock& code_block = func_def.code_block;
+	current_func_def = &func_def;
+	line_label.clear();
+	for (uint line_no = 0; line_no <= code_block.size(); ++line_no) { line_label.push_back(assembler.NewLabel()); }
+	exit_label = assembler.NewLabel();
+	subscript_out_of_range_label = assembler.NewLabel();
+	stack_overflow_label = assembler.NewLabel();
+
+	ReadPrologue();
+	for (uint line_no = 0; line_no < code_block.size(); ++line_no) {
+		assembler.Bind(line_label[line_no]);
+		ReadCodeLine(code_block, line_no);
+	}
+	assembler.Bind(line_label[code_block.size()]);
+	ReadReturn(CodeLine::ReturnVoid());
+
+	assembler.Bind(subscript_out_of_range_label);
+	assembler.MovRegImm(rax, (int)JitStatus::SubscriptOutOfRange);
+	assembler.Jmp(exit_label);
+	assembler.Bind(stack_overflow_label);
+	assembler.MovRegImm(rax, (int)JitStatus::StackOverflow);
+	assembler.Bind(exit_label);
+	ReadEpilogue();
+}
+
+bool LinearCodeJit::CompileFunc(uint func_index) {
+	assert(func_index < global_func_table.size() && !IsCompiled(func_index));
+	const GlobalFuncDef& func_def = global_func_table[func_index];
+	assembler = X86Assembler(); is_unsupported = false;
+	ReadFuncDef(func_def);
+	uint resume_offset = assembler.GetSize();
+	ReadPrologue();
+	assembler.JmpReg(rsi);
+	if (is_unsupported) { return false; }
+	assembler.ResolveLabels();
+	const uchar* code = CommitCode(assembler.GetCode());
+	if (code == nullptr) { return false; }
+
+	FuncCode& func_code = func_code_table[func_index];
+	func_code.entry = code;
+	func_code.resume_entry = code + resume_offset;
+	for (uint line_no : func_def.label_map) {
+		assert(line_no <= func_def.code_block.size());
+		func_code.label_entry.push_back(code + assembler.GetLabelOffset(line_label[line_no]));
+	}
+	func_entry_table[func_index] = code;
+	return true;
+}
+
+JitStatus LinearCodeJit::ExecuteFunc(uint func_index) {
+	assert(IsCompiled(func_index));
+	return (JitStatus)enter_func(&context, func_code_table[func_index].entry, nullptr);
+}
+
+JitStatus LinearCodeJit::ExecuteFuncFromLabel(uint func_index, uint label_index) {
+	assert(IsCompiled(func_index) && label_index < func_code_table[func_index].label_entry.size());
+	const FuncCode& func_code = func_code_table[func_index];
+	return (JitStatus)enter_func(&context, func_code.resume_entry, func_code.label_entry[label_index]);
+}
+
+#endif
\ No newline at end of file
@@ -0,0 +1,147 @@
+#pragma once
+
+#include "linear_code.h"
+#include "x86_assembler.h"
+
+#include <vector>
+
+
+using std::vector;
+
+
+// Machine code is generated for Linux x86-64 hosts only.
+#if defined(__x86_64__) && defined(__linux__) && !defined(LINEAR_CODE_NO_JIT)
+#define LINEAR_CODE_JIT
+#endif
+
+
+enum class JitStatus : int {
+	Success,
+	Exception,				// thrown by a callback, kept by the owner of the context
+	SubscriptOutOfRange,
+	StackOverflow,
+};
+
+
+// The state shared by the generated code and the interpreter, accessed by the generated code at fixed offsets.
+//   Frames are laid out in the variable stack exactly as LinearCodeInterpreter does, and addresses are indices
+//   into it, so that interpreted and compiled functions can call each other.
+struct JitContext {
+	ref_ptr<int> stack_base = nullptr;
+	uint64 stack_size = 0;
+	uint stack_top = 0;
+	uint frame_pointer = 0;
+	uint frame_size = 0;
+	int return_value = 0;
+	ref_ptr<const void* const> func_entry_table = nullptr;
+	ref_ptr<void> owner = nullptr;
+
+	// callbacks to the owner, each returns a JitStatus
+	int(*call_interpreted)(JitContext* context, uint func_index) = nullptr;  // on the frame already entered
+	int(*call_library)(JitContext* context, uint func_index, int arg0, int arg1) = nullptr;  // sets return_value
+	int(*grow_stack)(JitContext* context, uint64 new_stack_top) = nullptr;
+
+	// compiled code runs on its own native stack, so that deep recursion doesn't overflow the stack of the host
+	ref_ptr<char> native_stack_begin = nullptr;
+	uint64 native_stack_size = 0;
+	ref_ptr<char> native_stack_limit = nullptr;
+};
+
+
+class LinearCodeJit {
+public:
+	struct Option {
+		bool check_indirect_access = true;	// bounds-check accesses through an address or with a variable subscript
+		bool poison_local_var = true;
+		int local_var_initial_value = 0;
+		uint64 native_stack_size = 1 << 28;
+	};
+
+private:
+	JitContext& context;
+	const GlobalFuncTable& global_func_table;
+	const Option option;
+
+public:
+	LinearCodeJit(JitContext& context, const GlobalFuncTable& global_func_table, Option option);
+	~LinearCodeJit();
+
+private:
+	struct CodeMemory {
+		alloc_ptr<void> addr;
+		size_t size;
+	};
+	vector<CodeMemory> code_memory_list;
+
+	struct FuncCode {
+		ref_ptr<const void> entry = nullptr;
+		ref_ptr<const void> resume_entry = nullptr;	// continues at the address passed in rsi
+		vector<ref_ptr<const void>> label_entry;
+	};
+	vector<FuncCode> func_code_table;
+	vector<const void*> func_entry_table;  // compiled code, or a stub calling back the interpreter
+
+	using EnterFuncPtr = int(*)(JitContext* context, const void* code, const void* target);
+	EnterFuncPtr enter_func = nullptr;
+
+private:
+	alloc_ptr<char> native_stack = nullptr;
+
+private:
+	ref_ptr<const uchar> CommitCode(const vector<uchar>& code);
+	void GenerateStubs();
+
+private:
+	using VarType = CodeLineVarType::Type;
+	struct VarInfo : CodeLineVarType {
+	public:
+		const int value;
+		VarInfo(const CodeLine& line, int index) : CodeLineVarType(GetVarInfo(line, index)), value(line.var[index]) {}
+	private:
+		static CodeLineVarType GetVarInfo(const CodeLine& line, int index) {
+			assert(index >= 0 && index < 3);
+			return line.var_type[index];
+		}
+	};
+
+private:
+	// the function being compiled
+	X86Assembler assembler;
+	ref_ptr<const GlobalFuncDef> current_func_def = nullptr;
+	vector<X86Assembler::Label> line_label;
+	X86Assembler::Label exit_label = 0;
+	X86Assembler::Label subscript_out_of_range_label = 0;
+	X86Assembler::Label stack_overflow_label = 0;
+	bool is_unsupported = false;  // set if a variable offset doesn't fit in a displacement
+
+private:
+	X86Mem GetVarMem(VarInfo var, int offset = 0);
+	void LoadValueVar(X86Reg reg, VarInfo var);
+	void StoreValueVar(VarInfo var, X86Reg reg);
+	void LoadAddrVar(X86Reg reg, VarInfo var, VarInfo offset);
+	void CheckAddr(X86Reg reg);
+	void LoadRangeAddr(X86Reg reg, VarInfo var, int length);
+	void ReloadFrameBase();
+private:
+	void ReadPrologue();
+	void ReadEpilogue();
+	void ReadBinaryOp(const CodeLine& line);
+	void ReadUnaryOp(const CodeLine& line);
+	void ReadAddr(const CodeLine& line);
+	void ReadLoad(const CodeLine& line);
+	void ReadStore(const CodeLine& line);
+	void ReadFill(const CodeLine& line);
+	void ReadMemCopy(const CodeLine& line);
+	void ReadLibraryFuncCall(const CodeBlock& code_block, uint& line_no);
+	void ReadFuncCall(const CodeBlock& code_block, uint& line_no);
+	void ReadJumpIf(const CodeLine& line);
+	void ReadReturn(const CodeLine& line);
+	void ReadCodeLine(const CodeBlock& code_block, uint& line_no);
+	void ReadFuncDef(const GlobalFuncDef& func_def);
+
+public:
+	bool IsCompiled(uint func_index) const { return func_code_table[func_index].entry != nullptr; }
+	bool CompileFunc(uint func_index);
+	JitStatus ExecuteFunc(uint func_index);  // on the frame already entered
+	JitStatus ExecuteFuncFromLabel(uint func_index, uint label_index);
+};
\ No newline at end of file
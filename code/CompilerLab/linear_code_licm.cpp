@@ -0,0 +1,155 @@
+#include "linear_code_licm.h"
+#include "linear_code_loop.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+
+namespace {
+
+// Memory which may be written in a loop.
+struct LoopMemoryEffect {
+	bool has_call = false;
+	bool has_pointer_store = false;
+	bool has_global_store_at_offset = false;
+	vector<bool> is_local_array_written;  // per entry of local_array_list, arrays sharing slots being one entry
+	std::unordered_set<int> written_global;
+};
+
+
+class InvariantHoister {
+private:
+	FuncIR& func_ir;
+	vector<IRBlock>& block_list;
+	LoopForest loop_forest;
+	vector<uint> def_block;  // -1 for registers defined at entry
+	vector<bool> is_local_array_escaped;
+
+public:
+	InvariantHoister(FuncIR& func_ir, const DominatorTree& dominator_tree);
+
+private:
+	LoopMemoryEffect GetMemoryEffect(uint loop) const;
+	bool IsInvariant(uint loop, const IROperand& operand) const {
+		if (operand.IsNumber()) { return true; }
+		if (operand.IsReg()) { return def_block[operand.GetReg()] == -1 || !loop_forest.Contains(loop, def_block[operand.GetReg()]); }
+		return false;
+	}
+	bool IsInvariantLoad(const LoopMemoryEffect& effect, const IROperand& memory) const;
+	bool IsInvariant(uint loop, const LoopMemoryEffect& effect, const IRInstr& instr) const;
+public:
+	void Run();
+};
+
+InvariantHoister::InvariantHoister(FuncIR& func_ir, const DominatorTree& dominator_tree) :
+	func_ir(func_ir), block_list(func_ir.block_list), loop_forest(func_ir, dominator_tree),
+	def_block(func_ir.GetRegCount(), -1), is_local_array_escaped(func_ir.local_array_list.size(), false) {
+	loop_forest.InsertPreheader(func_ir);
+	def_block.resize(func_ir.GetRegCount(), -1);
+	for (uint block = 0; block < block_list.size(); ++block) {
+		for (const IRInstr& instr : block_list[block].instr_list) {
+			if (instr.HasDest() && instr.GetDest().IsReg()) { def_block[instr.GetDest().GetReg()] = block; }
+			if (instr.type == IRInstrType::Addr && instr.var[1].type == IROperandType::Local) {
+				uint array = func_ir.GetLocalArray(instr.var[1].value);
+				if (array != -1) { is_local_array_escaped[array] = true; }
+			}
+		}
+	}
+}
+
+LoopMemoryEffect InvariantHoister::GetMemoryEffect(uint loop) const {
+	LoopMemoryEffect effect;
+	effect.is_local_array_written.assign(func_ir.local_array_list.size(), false);
+	auto Write = [&](const IROperand& base, const IROperand& offset) {
+		switch (base.type) {
+		case IROperandType::Reg:
+			effect.has_pointer_store = true;
+			break;
+		case IROperandType::Local: {
+			uint array = func_ir.GetLocalArray(base.value);
+			if (array != -1) { effect.is_local_array_written[array] = true; }
+			break;
+		}
+		case IROperandType::Global:
+			if (offset.IsNumber()) { effect.written_global.insert(base.value + offset.value); } else { effect.has_global_store_at_offset = true; }
+			break;
+		default:
+			break;
+		}
+	};
+	for (uint block : loop_forest.loop_list[loop].block_list) {
+		for (const IRInstr& instr : block_list[block].instr_list) {
+			if (instr.type == IRInstrType::Call) { effect.has_call = true; }
+			if (instr.type == IRInstrType::Store) { Write(instr.var[0], instr.var[1]); }
+			if (instr.type == IRInstrType::Fill || instr.type == IRInstrType::MemCopy) { Write(instr.var[0], IROperand()); }  // at unknown offsets
+			if (instr.HasDest() && instr.GetDest().IsMemory()) { Write(instr.GetDest(), IROperand::Number(0)); }
+		}
+	}
+	return effect;
+}
+
+bool InvariantHoister::IsInvariantLoad(const LoopMemoryEffect& effect, const IROperand& memory) const {
+	if (memory.type == IROperandType::Local) {
+		uint array = func_ir.GetLocalArray(memory.value);
+		if (array == -1 || effect.is_local_array_written[array]) { return false; }
+		return !is_local_array_escaped[array] || (!effect.has_call && !effect.has_pointer_store);
+	} else {
+		assert(memory.type == IROperandType::Global);
+		return !effect.has_call && !effect.has_pointer_store && !effect.has_global_store_at_offset && effect.written_global.count(memory.value) == 0;
+	}
+}
+
+bool InvariantHoister::IsInvariant(uint loop, const LoopMemoryEffect& effect, const IRInstr& instr) const {
+	if (!instr.HasDest() || !instr.GetDest().IsReg()) { return false; }
+	switch (instr.type) {
+	case IRInstrType::BinaryOp:
+		if ((instr.op == OperatorType::Div || instr.op == OperatorType::Mod) &&
+			!(instr.var[2].IsNumber() && instr.var[2].value != 0 && instr.var[2].value != -1)) {
+			return false;
+		}
+		return IsInvariant(loop, instr.var[1]) && IsInvariant(loop, instr.var[2]);
+	case IRInstrType::UnaryOp:
+		return IsInvariant(loop, instr.var[1]);
+	case IRInstrType::Copy:
+		return instr.var[1].IsMemory() ? IsInvariantLoad(effect, instr.var[1]) : IsInvariant(loop, instr.var[1]);
+	case IRInstrType::Addr:  // the address of a memory base is a constant
+		return (instr.var[1].IsMemory() || IsInvariant(loop, instr.var[1])) && IsInvariant(loop, instr.var[2]);
+	case IRInstrType::Load:
+		if (instr.var[1].IsMemory() && instr.var[2].IsNumber()) {
+			IROperand memory = instr.var[1]; memory.value += instr.var[2].value;
+			return IsInvariantLoad(effect, memory);
+		}
+		return false;
+	default:
+		return false;
+	}
+}
+
+void InvariantHoister::Run() {
+	for (uint loop = 0; loop < loop_forest.loop_list.size(); ++loop) {
+		const IRLoop& ir_loop = loop_forest.loop_list[loop];
+		LoopMemoryEffect effect = GetMemoryEffect(loop);
+		vector<IRInstr>& preheader_instr_list = block_list[ir_loop.preheader].instr_list;
+		for (uint block : ir_loop.block_list) {
+			vector<IRInstr> instr_list;
+			for (IRInstr& instr : block_list[block].instr_list) {
+				if (IsInvariant(loop, effect, instr)) {
+					def_block[instr.GetDest().GetReg()] = ir_loop.preheader;
+					preheader_instr_list.push_back(std::move(instr));
+				} else {
+					instr_list.push_back(std::move(instr));
+				}
+			}
+			block_list[block].instr_list = std::move(instr_list);
+		}
+	}
+}
+
+} // namespace
+
+
+void HoistLoopInvariant(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	func_ir.RemoveUnreachableBlock();
+	InvariantHoister(func_ir, DominatorTree(func_ir)).Run();
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Moves loop invariant computations of a FuncIR in SSA form to loop preheaders, inner loops first, so that
+//   an invariant of nested loops moves out of all of them. Arithmetic that may trap is not moved, and loads
+//   are only moved from constant addresses which are not written in the loop by stores, pointers or calls.
+void HoistLoopInvariant(FuncIR& func_ir);
\ No newline at end of file
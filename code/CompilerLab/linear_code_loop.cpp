@@ -0,0 +1,94 @@
+#include "linear_code_loop.h"
+
+#include <algorithm>
+
+
+LoopForest::LoopForest(const FuncIR& func_ir, const DominatorTree& dominator_tree) : block_loop(func_ir.block_list.size(), -1) {
+	const vector<IRBlock>& block_list = func_ir.block_list;
+	vector<uint> header_loop(block_list.size(), -1);
+	for (uint block : dominator_tree.order) {
+		for (uint successor : block_list[block].GetSuccessorList()) {
+			if (!dominator_tree.Dominates(successor, block)) { continue; }
+			if (header_loop[successor] == -1) { header_loop[successor] = (uint)loop_list.size(); loop_list.push_back(IRLoop{ successor }); }
+			loop_list[header_loop[successor]].latch_list.push_back(block);
+		}
+	}
+
+	// the body is the header and blocks reaching a latch without passing the header
+	vector<uint> mark(block_list.size(), -1);
+	for (uint loop = 0; loop < loop_list.size(); ++loop) {
+		IRLoop& ir_loop = loop_list[loop];
+		mark[ir_loop.header] = loop;
+		vector<uint> work_list;
+		for (uint latch : ir_loop.latch_list) {
+			if (mark[latch] != loop) { mark[latch] = loop; work_list.push_back(latch); }
+		}
+		vector<uint> body{ ir_loop.header };
+		while (!work_list.empty()) {
+			uint block = work_list.back(); work_list.pop_back();
+			body.push_back(block);
+			for (uint predecessor : block_list[block].predecessor_list) {
+				if (mark[predecessor] != loop) { mark[predecessor] = loop; work_list.push_back(predecessor); }
+			}
+		}
+		std::sort(body.begin() + 1, body.end(), [&](uint a, uint b) { return dominator_tree.order_index[a] < dominator_tree.order_index[b]; });
+		ir_loop.block_list = std::move(body);
+	}
+
+	// an inner loop has fewer blocks, so the innermost loop of a block is the last one assigned from outer loops
+	std::stable_sort(loop_list.begin(), loop_list.end(), [](const IRLoop& a, const IRLoop& b) { return a.block_list.size() < b.block_list.size(); });
+	for (uint loop = (uint)loop_list.size(); loop-- > 0;) {
+		loop_list[loop].parent = block_loop[loop_list[loop].header];
+		for (uint block : loop_list[loop].block_list) { block_loop[block] = loop; }
+	}
+}
+
+void LoopForest::InsertPreheader(FuncIR& func_ir) {
+	vector<IRBlock>& block_list = func_ir.block_list;
+	for (uint loop = 0; loop < loop_list.size(); ++loop) {
+		uint header = loop_list[loop].header;
+		vector<uint> entering_index;  // of predecessors out of the loop
+		for (uint k = 0; k < block_list[header].predecessor_list.size(); ++k) {
+			if (!Contains(loop, block_list[header].predecessor_list[k])) { entering_index.push_back(k); }
+		}
+		assert(!entering_index.empty());
+		uint predecessor = block_list[header].predecessor_list[entering_index.front()];
+		if (entering_index.size() == 1 && block_list[predecessor].exit_type == IRExitType::Goto) {
+			loop_list[loop].preheader = predecessor;
+			continue;
+		}
+
+		uint preheader = (uint)block_list.size();
+		block_list.emplace_back();
+		IRBlock& ir_preheader = block_list.back();
+		IRBlock& ir_header = block_list[header];
+		ir_preheader.SetGoto(header);
+		for (uint k : entering_index) {
+			IRBlock& ir_block = block_list[ir_header.predecessor_list[k]];
+			if (ir_block.target == header) { ir_block.target = preheader; }
+			if (ir_block.next == header) { ir_block.next = preheader; }
+			ir_preheader.predecessor_list.push_back(ir_header.predecessor_list[k]);
+		}
+		for (uint index = 0; index < ir_header.GetPhiCount(); ++index) {
+			IRInstr& phi = ir_header.instr_list[index];
+			vector<IROperand> argument_list;
+			for (uint k : entering_index) { argument_list.push_back(phi.argument_list[k]); }
+			if (std::all_of(argument_list.begin(), argument_list.end(), [&](const IROperand& argument) { return argument == argument_list.front(); })) {
+				phi.argument_list.push_back(argument_list.front());
+			} else {
+				uint reg = func_ir.AllocateReg(func_ir.reg_is_pointer[phi.GetDest().GetReg()]);
+				ir_preheader.instr_list.push_back(IRInstr::Phi(IROperand::Reg(reg), std::move(argument_list)));
+				phi.argument_list.push_back(IROperand::Reg(reg));
+			}
+		}
+		ir_header.predecessor_list.push_back(preheader);
+		func_ir.UpdatePredecessor();
+
+		loop_list[loop].preheader = preheader;
+		block_loop.push_back(loop_list[loop].parent);
+		for (uint outer = loop_list[loop].parent; outer != -1; outer = loop_list[outer].parent) {
+			vector<uint>& outer_block_list = loop_list[outer].block_list;
+			outer_block_list.insert(std::find(outer_block_list.begin(), outer_block_list.end(), header), preheader);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "linear_code_dominator.h"
+
+
+// A natural loop, with the back edges to the same header merged.
+struct IRLoop {
+	uint header;
+	uint parent = -1;  // the innermost loop containing this one
+	uint preheader = -1;  // set by LoopForest::InsertPreheader
+	vector<uint> block_list;  // the header first, including blocks of inner loops
+	vector<uint> latch_list;  // sources of back edges
+};
+
+
+// Natural loops of a FuncIR, found by back edges to dominating headers, so irreducible cycles are not loops.
+class LoopForest {
+public:
+	vector<IRLoop> loop_list;  // inner loops before outer ones
+	vector<uint> block_loop;  // the innermost loop of each block, -1 if not in a loop
+
+public:
+	LoopForest(const FuncIR& func_ir, const DominatorTree& dominator_tree);
+
+public:
+	bool Contains(uint loop, uint block) const {
+		for (uint inner = block_loop[block]; inner != -1; inner = loop_list[inner].parent) { if (inner == loop) { return true; } }
+		return false;
+	}
+	// Gives each loop a predecessor out of the loop which only goes to the header, adding a block if there isn't one,
+	//   and moving phi arguments of the entering edges to a phi there in SSA form. The dominator tree is not updated.
+	void InsertPreheader(FuncIR& func_ir);
+};
\ No newline at end of file
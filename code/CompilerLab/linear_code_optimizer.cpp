@@ -0,0 +1,33 @@
+#include "linear_code_optimizer.h"
+#include "linear_code_inline.h"
+#include "linear_code_ssa.h"
+#include "linear_code_copy.h"
+#include "linear_code_sccp.h"
+#include "linear_code_gvn.h"
+#include "linear_code_licm.h"
+#include "linear_code_iv.h"
+#include "linear_code_dce.h"
+
+
+void LinearCodeOptimizer::OptimizeFunc(FuncIR& func_ir) {
+	ConstructSSA(func_ir);
+	PropagateCopy(func_ir);
+	PropagateConstant(func_ir);
+	NumberValue(func_ir);
+	HoistLoopInvariant(func_ir);
+	ReduceInductionVariable(func_ir);
+	NumberValue(func_ir);  // merges computations hoisted from different loops
+	EliminateDeadCode(func_ir);
+	DestructSSA(func_ir);
+	func_ir.RemoveEmptyBlock();
+}
+
+void LinearCodeOptimizer::Optimize(LinearCode& linear_code) {
+	vector<FuncIR> func_list; func_list.reserve(linear_code.global_func_table.size());
+	for (const GlobalFuncDef& func_def : linear_code.global_func_table) { func_list.emplace_back(func_def); }
+	InlineFunc(func_list);
+	for (uint i = 0; i < func_list.size(); ++i) {
+		OptimizeFunc(func_list[i]);
+		linear_code.global_func_table[i] = func_list[i].Lower();
+	}
+}
\ No newline at end of file
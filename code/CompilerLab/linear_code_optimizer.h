@@ -0,0 +1,12 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Transforms each function of LinearCode in the form of FuncIR.
+class LinearCodeOptimizer {
+private:
+	void OptimizeFunc(FuncIR& func_ir);
+public:
+	void Optimize(LinearCode& linear_code);
+};
\ No newline at end of file
@@ -0,0 +1,207 @@
+#include "linear_code_profiler.h"
+#include "analyzer_debug_helper.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <tuple>
+#include <limits>
+
+
+constexpr uint hot_loop_number = 10;
+constexpr uint hot_line_number = 20;
+constexpr double hot_line_ratio = 0.01;  // lines taking at least this share of all executed lines are marked in the listing
+constexpr uint folded_stack_half_depth = 512;  // frames kept at each end of a deeper sampled stack
+
+
+LinearCodeProfiler::LinearCodeProfiler(const GlobalFuncTable& global_func_table, uint64 sample_interval) :
+	global_func_table(global_func_table), func_record_table(global_func_table.size()),
+	stack_node_table{ StackNode{ 0, 0, 0, 0, 0 } }, sample_interval(sample_interval),
+	sample_countdown(sample_interval > 0 ? sample_interval : std::numeric_limits<uint64>::max()) {
+	uint line_counter_number = 0;
+	for (auto& func_def : global_func_table) {
+		line_counter_offset.push_back(line_counter_number);
+		line_counter_number += (uint)func_def.code_block.size();
+	}
+	line_count.assign(line_counter_number, 0);
+	fall_through_count.assign(line_counter_number, 0);
+}
+
+void LinearCodeProfiler::EnterFunc(uint func_index) {
+	FuncRecord& func_record = func_record_table[func_index];
+	func_record.call_count++;
+	func_record.active_frame_count++;
+	uint stack_node = sample_interval > 0 ? GetStackNode(call_stack.empty() ? 0 : call_stack.back().stack_node, func_index) : 0;
+	call_stack.push_back(Frame{ func_index, Clock::now(), Clock::duration::zero(), stack_node });
+}
+
+void LinearCodeProfiler::LeaveFunc() {
+	Clock::time_point time = Clock::now();
+	assert(!call_stack.empty());
+	Frame frame = call_stack.back(); call_stack.pop_back();
+	Clock::duration elapsed_time = time - frame.enter_time;
+	FuncRecord& func_record = func_record_table[frame.func_index];
+	func_record.exclusive_time += elapsed_time - frame.callee_time;
+	if (--func_record.active_frame_count == 0) { func_record.inclusive_time += elapsed_time; }
+	if (!call_stack.empty()) { call_stack.back().callee_time += elapsed_time; }
+}
+
+uint LinearCodeProfiler::GetStackNode(uint parent, uint func_index) {
+	auto [it, is_inserted] = stack_node_map.emplace((uint64)parent << 32 | func_index, (uint)stack_node_table.size());
+	if (is_inserted) {
+		uint node = it->second, depth = stack_node_table[parent].depth + 1;
+		uint outer_node = depth <= folded_stack_half_depth ? node : stack_node_table[parent].outer_node;
+		stack_node_table.push_back(StackNode{ parent, func_index, depth, outer_node, 0 });
+	}
+	return it->second;
+}
+
+void LinearCodeProfiler::Sample() {
+	sample_countdown = sample_interval;
+	stack_node_table[call_stack.empty() ? 0 : call_stack.back().stack_node].sample_count++;
+}
+
+uint64 LinearCodeProfiler::GetTakenCount(uint func_index, uint line_no) const {
+	uint counter = GetLineCounter(func_index, line_no);
+	switch (global_func_table[func_index].code_block[line_no].type) {
+	case CodeLineType::JumpIf: return line_count[counter] - fall_through_count[counter];
+	case CodeLineType::Goto: return line_count[counter];
+	default: return 0;
+	}
+}
+
+inline double GetMilliseconds(std::chrono::steady_clock::duration time) {
+	return std::chrono::duration<double, std::milli>(time).count();
+}
+
+void LinearCodeProfiler::PrintFuncSummary(std::ostream& os) {
+	vector<uint> func_list;
+	for (uint i = 0; i < func_record_table.size(); ++i) {
+		if (func_record_table[i].call_count > 0) { func_list.push_back(i); }
+	}
+	std::stable_sort(func_list.begin(), func_list.end(), [&](uint a, uint b) {
+		return func_record_table[a].exclusive_time > func_record_table[b].exclusive_time;
+	});
+	os << "functions by exclusive time:" << endl;
+	os << std::setw(12) << "function" << std::setw(14) << "calls" << std::setw(16) << "inclusive ms" << std::setw(16) << "exclusive ms" << endl;
+	for (uint func_index : func_list) {
+		const FuncRecord& func_record = func_record_table[func_index];
+		os << std::setw(12) << "func" + std::to_string(func_index + library_func_number) << std::setw(14) << func_record.call_count
+			<< std::setw(16) << GetMilliseconds(func_record.inclusive_time) << std::setw(16) << GetMilliseconds(func_record.exclusive_time) << endl;
+	}
+	os << endl;
+}
+
+// A loop is identified by a backward jump, from its last line to its first line.
+void LinearCodeProfiler::PrintHotLoops(std::ostream& os) {
+	uint64 total_count = 0; for (uint64 count : line_count) { total_count += count; }
+	vector<std::tuple<uint64, uint, uint, uint>> loop_list;  // (iteration count, function, first line, last line)
+	for (uint func_index = 0; func_index < global_func_table.size(); ++func_index) {
+		const GlobalFuncDef& func_def = global_func_table[func_index];
+		for (uint line_no = 0; line_no < func_def.code_block.size(); ++line_no) {
+			const CodeLine& line = func_def.code_block[line_no];
+			if (line.type != CodeLineType::JumpIf && line.type != CodeLineType::Goto) { continue; }
+			uint target = func_def.label_map[line.var[0]];
+			uint64 iteration_count = GetTakenCount(func_index, line_no);
+			if (target <= line_no && iteration_count > 0) { loop_list.push_back({ iteration_count, func_index, target, line_no }); }
+		}
+	}
+	std::stable_sort(loop_list.begin(), loop_list.end(), [](auto& a, auto& b) { return std::get<0>(a) > std::get<0>(b); });
+	if (loop_list.size() > hot_loop_number) { loop_list.resize(hot_loop_number); }
+	os << "hot loops:" << endl;
+	for (auto [iteration_count, func_index, first, last] : loop_list) {
+		uint64 body_count = 0;
+		for (uint line_no = first; line_no <= last; ++line_no) { body_count += line_count[GetLineCounter(func_index, line_no)]; }
+		os << std::setw(12) << "func" + std::to_string(func_index + library_func_number) << " lines " << first << "-" << last << ": "
+			<< iteration_count << " iterations, " << std::setw(7) << body_count * 100.0 / total_count << "% of executed lines" << endl;
+	}
+	os << endl;
+}
+
+void LinearCodeProfiler::PrintHotLines(std::ostream& os) {
+	uint64 total_count = 0; for (uint64 count : line_count) { total_count += count; }
+	vector<std::pair<uint, uint>> line_list;  // (function, line)
+	for (uint func_index = 0; func_index < global_func_table.size(); ++func_index) {
+		for (uint line_no = 0; line_no < global_func_table[func_index].code_block.size(); ++line_no) {
+			if (line_count[GetLineCounter(func_index, line_no)] > 0) { line_list.push_back({ func_index, line_no }); }
+		}
+	}
+	auto GetCount = [&](std::pair<uint, uint> line) { return line_count[GetLineCounter(line.first, line.second)]; };
+	std::stable_sort(line_list.begin(), line_list.end(), [&](auto a, auto b) { return GetCount(a) > GetCount(b); });
+	if (line_list.size() > hot_line_number) { line_list.resize(hot_line_number); }
+	os << "hot lines of " << total_count << " executed:" << endl;
+	AnalyzerDebugHelper helper(os);
+	for (auto [func_index, line_no] : line_list) {
+		uint64 count = GetCount({ func_index, line_no });
+		os << std::setw(12) << "func" + std::to_string(func_index + library_func_number) + ":" + std::to_string(line_no)
+			<< std::setw(14) << count << std::setw(8) << count * 100.0 / total_count << "%  ";
+		helper.PrintFuncCodeLine(global_func_table[func_index], line_no);
+	}
+	os << endl;
+}
+
+// Each line is prefixed with its execution count and share, and the taken ratio for a JumpIf.
+//   Parameters are counted with their call.
+void LinearCodeProfiler::PrintAnnotatedCode(std::ostream& os) {
+	uint64 total_count = 0; for (uint64 count : line_count) { total_count += count; }
+	os << "annotated code:" << endl;
+	AnalyzerDebugHelper helper(os);
+	for (uint func_index = 0; func_index < global_func_table.size(); ++func_index) {
+		const GlobalFuncDef& func_def = global_func_table[func_index];
+		const FuncRecord& func_record = func_record_table[func_index];
+		os << "# calls " << func_record.call_count << ", inclusive " << GetMilliseconds(func_record.inclusive_time)
+			<< " ms, exclusive " << GetMilliseconds(func_record.exclusive_time) << " ms" << endl;
+		uint64 call_count = 0;
+		helper.PrintFuncDef(func_def, func_index + library_func_number, [&](uint line_no) {
+			const CodeLine& line = func_def.code_block[line_no];
+			uint64 count = line_count[GetLineCounter(func_index, line_no)];
+			if (line.type == CodeLineType::FuncCall) { call_count = count; }
+			if (line.type == CodeLineType::Parameter) { count = call_count; }
+			double ratio = total_count > 0 ? (double)count / total_count : 0;
+			os << (ratio >= hot_line_ratio ? '*' : ' ') << std::setw(13) << count << std::setw(8) << ratio * 100 << "%";
+			if (line.type == CodeLineType::JumpIf && count > 0) {
+				os << "  taken " << std::setw(7) << GetTakenCount(func_index, line_no) * 100.0 / count << "%";
+			} else {
+				os << std::string(16, ' ');
+			}
+			os << "  " << line_no << '\t';
+		});
+	}
+}
+
+void LinearCodeProfiler::PrintReport(std::ostream& os) {
+	while (!call_stack.empty()) { LeaveFunc(); }
+	std::ios_base::fmtflags flags = os.flags(); std::streamsize precision = os.precision();
+	os << std::fixed << std::setprecision(3);
+	PrintFuncSummary(os);
+	PrintHotLoops(os);
+	PrintHotLines(os);
+	PrintAnnotatedCode(os);
+	os.flags(flags); os.precision(precision);
+}
+
+// Each line is built as a string, as the stream may be unbuffered.
+void LinearCodeProfiler::PrintFoldedStacks(std::ostream& os) {
+	vector<uint> path; std::string line;
+	auto AppendPath = [&](uint node, uint depth) {
+		path.clear();
+		for (uint i = 0; i < depth; ++i, node = stack_node_table[node].parent) { path.push_back(stack_node_table[node].func_index); }
+		for (auto it = path.rbegin(); it != path.rend(); ++it) {
+			line += "func" + std::to_string(*it + library_func_number) + (it + 1 != path.rend() ? ";" : "");
+		}
+	};
+	for (uint node = 1; node < stack_node_table.size(); ++node) {
+		const StackNode& stack_node = stack_node_table[node];
+		if (stack_node.sample_count == 0) { continue; }
+		line.clear();
+		if (stack_node.depth <= folded_stack_half_depth * 2) {
+			AppendPath(node, stack_node.depth);
+		} else {
+			AppendPath(stack_node.outer_node, folded_stack_half_depth);
+			line += ";...;";
+			AppendPath(node, folded_stack_half_depth);
+		}
+		line += " " + std::to_string(stack_node.sample_count) + "\n";
+		os << line;
+	}
+	os.flush();
+}
\ No newline at end of file
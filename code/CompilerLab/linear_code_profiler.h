@@ -0,0 +1,86 @@
+#pragma once
+
+#include "linear_code.h"
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <unordered_map>
+
+
+using std::vector;
+
+
+// Collects the profile of a run of LinearCodeInterpreter, which emits profiling instructions when decoding:
+//   the execution count of each CodeLine, the fall-through count of each JumpIf, and the call count,
+//   inclusive and exclusive time of each function. Then writes a report with an annotated listing of the code.
+// The call stack can also be sampled every fixed number of executed lines, and written as folded stacks.
+class LinearCodeProfiler {
+private:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	const GlobalFuncTable& global_func_table;
+
+public:
+	LinearCodeProfiler(const GlobalFuncTable& global_func_table, uint64 sample_interval = 0);  // no sampling if 0
+
+private:
+	vector<uint> line_counter_offset;  // the counter of the first line of each function
+	vector<uint64> line_count;
+	vector<uint64> fall_through_count;  // for JumpIf lines
+
+	struct FuncRecord {
+		uint64 call_count = 0;
+		Clock::duration inclusive_time = Clock::duration::zero();  // recursive calls are counted once
+		Clock::duration exclusive_time = Clock::duration::zero();
+		uint active_frame_count = 0;
+	};
+	vector<FuncRecord> func_record_table;
+
+	struct Frame {
+		uint func_index;
+		Clock::time_point enter_time;
+		Clock::duration callee_time;
+		uint stack_node;
+	};
+	vector<Frame> call_stack;
+
+	// The sampled call stacks are kept as a tree of call paths, the root for the empty stack.
+	//   A deep stack is written with only its outermost and innermost frames, the outermost ending at outer_node.
+	struct StackNode {
+		uint parent;
+		uint func_index;
+		uint depth;
+		uint outer_node;
+		uint64 sample_count;
+	};
+	vector<StackNode> stack_node_table;
+	std::unordered_map<uint64, uint> stack_node_map;  // (parent, func_index) -> node
+	const uint64 sample_interval;
+	uint64 sample_countdown;
+
+private:
+	uint GetStackNode(uint parent, uint func_index);
+	void Sample();
+
+public:
+	uint GetLineCounter(uint func_index, uint line_no) const { return line_counter_offset[func_index] + line_no; }
+	void CountLine(uint counter) {
+		line_count[counter]++;
+		if (--sample_countdown == 0) { Sample(); }
+	}
+	void CountFallThrough(uint counter) { fall_through_count[counter]++; }
+	void EnterFunc(uint func_index);
+	void LeaveFunc();
+
+private:
+	uint64 GetTakenCount(uint func_index, uint line_no) const;
+	void PrintFuncSummary(std::ostream& os);
+	void PrintHotLoops(std::ostream& os);
+	void PrintHotLines(std::ostream& os);
+	void PrintAnnotatedCode(std::ostream& os);
+public:
+	void PrintReport(std::ostream& os);  // frames not returned from yet are left as if returning now
+	void PrintFoldedStacks(std::ostream& os);  // one line for each sampled call path: "func9;func8;func8 count"
+};
\ No newline at end of file
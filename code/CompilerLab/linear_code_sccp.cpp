@@ -0,0 +1,183 @@
+#include "linear_code_sccp.h"
+
+#include <algorithm>
+
+
+namespace {
+
+enum class LatticeType : uchar { Undefined, Constant, Variable };
+
+struct LatticeValue {
+	LatticeType type = LatticeType::Undefined;
+	int value = 0;
+
+public:
+	static LatticeValue Constant(int value) { return LatticeValue{ LatticeType::Constant, value }; }
+	static LatticeValue Variable() { return LatticeValue{ LatticeType::Variable }; }
+public:
+	bool IsConstant() const { return type == LatticeType::Constant; }
+	bool operator==(const LatticeValue& other) const { return type == other.type && value == other.value; }
+	bool operator!=(const LatticeValue& other) const { return !(*this == other); }
+	LatticeValue Meet(const LatticeValue& other) const {
+		if (type == LatticeType::Undefined) { return other; }
+		if (other.type == LatticeType::Undefined) { return *this; }
+		return *this == other ? *this : Variable();
+	}
+};
+
+
+class ConstantPropagator {
+private:
+	FuncIR& func_ir;
+	vector<IRBlock>& block_list;
+	IRDefUse def_use;
+	vector<LatticeValue> value;
+	vector<bool> is_block_executable;
+	vector<vector<bool>> is_edge_executable;  // of each predecessor of each block
+	vector<std::pair<uint, uint>> edge_work_list;  // (block, predecessor index)
+	vector<uint> reg_work_list;
+
+public:
+	ConstantPropagator(FuncIR& func_ir);
+
+private:
+	LatticeValue GetValue(const IROperand& operand) const {
+		if (operand.IsNumber()) { return LatticeValue::Constant(operand.value); }
+		if (operand.IsReg()) { return value[operand.GetReg()]; }
+		return LatticeValue::Variable();  // memory
+	}
+	void SetValue(uint reg, LatticeValue new_value) {
+		new_value = value[reg].Meet(new_value);  // only lowered, so that the propagation terminates
+		if (new_value != value[reg]) { value[reg] = new_value; reg_work_list.push_back(reg); }
+	}
+	void MarkEdge(uint block, uint successor) {
+		const vector<uint>& predecessor_list = block_list[successor].predecessor_list;
+		uint k = (uint)(std::find(predecessor_list.begin(), predecessor_list.end(), block) - predecessor_list.begin());
+		if (!is_edge_executable[successor][k]) { is_edge_executable[successor][k] = true; edge_work_list.push_back({ successor, k }); }
+	}
+	void VisitInstr(uint block, uint index);
+	void VisitExit(uint block);
+	void VisitSite(const IRSite& site) {
+		if (!is_block_executable[site.block]) { return; }
+		site.index == block_list[site.block].instr_list.size() ? VisitExit(site.block) : VisitInstr(site.block, site.index);
+	}
+	void Propagate();
+	void Rewrite();
+public:
+	void Run() { Propagate(); Rewrite(); }
+};
+
+ConstantPropagator::ConstantPropagator(FuncIR& func_ir) :
+	func_ir(func_ir), block_list(func_ir.block_list), def_use(func_ir.GetDefUse()),
+	value(func_ir.GetRegCount()), is_block_executable(func_ir.block_list.size(), false), is_edge_executable(func_ir.block_list.size()) {
+	for (uint block = 0; block < block_list.size(); ++block) {
+		is_edge_executable[block].assign(block_list[block].predecessor_list.size(), false);
+	}
+	// parameters and registers read before written are unknown
+	for (uint reg = 0; reg < func_ir.GetRegCount(); ++reg) {
+		if (def_use.def_list[reg].empty()) { value[reg] = LatticeValue::Variable(); }
+	}
+}
+
+void ConstantPropagator::VisitInstr(uint block, uint index) {
+	const IRInstr& instr = block_list[block].instr_list[index];
+	if (!instr.HasDest() || !instr.GetDest().IsReg()) { return; }
+	uint reg = instr.GetDest().GetReg();
+	switch (instr.type) {
+	case IRInstrType::BinaryOp: {
+		LatticeValue left = GetValue(instr.var[1]), right = GetValue(instr.var[2]);
+		if (left.IsConstant() && right.IsConstant()) {
+			int result;
+			SetValue(reg, EvalBinaryOperatorAsRuntime(instr.op, left.value, right.value, result) ? LatticeValue::Constant(result) : LatticeValue::Variable());
+		} else if (left.type == LatticeType::Variable || right.type == LatticeType::Variable) {
+			SetValue(reg, LatticeValue::Variable());
+		}
+		break;
+	}
+	case IRInstrType::UnaryOp: {
+		LatticeValue src = GetValue(instr.var[1]);
+		SetValue(reg, src.IsConstant() ? LatticeValue::Constant(instr.op == OperatorType::Sub ? (int)(0u - (uint)src.value) : EvalUnaryOperator(instr.op, src.value)) : src);
+		break;
+	}
+	case IRInstrType::Copy:
+		SetValue(reg, GetValue(instr.var[1]));
+		break;
+	case IRInstrType::Phi: {
+		LatticeValue result;
+		for (uint k = 0; k < instr.argument_list.size(); ++k) {
+			if (is_edge_executable[block][k]) { result = result.Meet(GetValue(instr.argument_list[k])); }
+		}
+		SetValue(reg, result);
+		break;
+	}
+	default:
+		SetValue(reg, LatticeValue::Variable());
+		break;
+	}
+}
+
+void ConstantPropagator::VisitExit(uint block) {
+	const IRBlock& ir_block = block_list[block];
+	switch (ir_block.exit_type) {
+	case IRExitType::Goto:
+		MarkEdge(block, ir_block.target);
+		break;
+	case IRExitType::JumpIf: {
+		LatticeValue left = GetValue(ir_block.exit_var[0]), right = GetValue(ir_block.exit_var[1]);
+		if (left.IsConstant() && right.IsConstant()) {
+			MarkEdge(block, EvalBinaryOperator(ir_block.exit_op, left.value, right.value) ? ir_block.target : ir_block.next);
+		} else if (left.type == LatticeType::Variable || right.type == LatticeType::Variable) {
+			MarkEdge(block, ir_block.target); MarkEdge(block, ir_block.next);
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+void ConstantPropagator::Propagate() {
+	is_block_executable[0] = true;
+	for (uint index = 0; index < block_list[0].instr_list.size(); ++index) { VisitInstr(0, index); }
+	VisitExit(0);
+	while (!edge_work_list.empty() || !reg_work_list.empty()) {
+		if (!edge_work_list.empty()) {
+			auto [block, k] = edge_work_list.back(); edge_work_list.pop_back();
+			if (is_block_executable[block]) {
+				for (uint index = 0; index < block_list[block].GetPhiCount(); ++index) { VisitInstr(block, index); }
+			} else {
+				is_block_executable[block] = true;
+				for (uint index = 0; index < block_list[block].instr_list.size(); ++index) { VisitInstr(block, index); }
+				VisitExit(block);
+			}
+		} else {
+			uint reg = reg_work_list.back(); reg_work_list.pop_back();
+			for (const IRSite& site : def_use.use_list[reg]) { VisitSite(site); }
+		}
+	}
+}
+
+void ConstantPropagator::Rewrite() {
+	auto Replace = [&](IROperand& operand) {
+		if (operand.IsReg() && value[operand.GetReg()].IsConstant()) { operand = IROperand::Number(value[operand.GetReg()].value); }
+	};
+	for (IRBlock& ir_block : block_list) {
+		ir_block.instr_list.erase(std::remove_if(ir_block.instr_list.begin(), ir_block.instr_list.end(), [&](const IRInstr& instr) {
+			return instr.HasDest() && instr.GetDest().IsReg() && value[instr.GetDest().GetReg()].IsConstant();
+		}), ir_block.instr_list.end());
+		for (IRInstr& instr : ir_block.instr_list) { instr.ForEachSrc(Replace); }
+		ir_block.ForEachExitSrc(Replace);
+		if (ir_block.exit_type == IRExitType::JumpIf && ir_block.exit_var[0].IsNumber() && ir_block.exit_var[1].IsNumber()) {
+			ir_block.SetGoto(EvalBinaryOperator(ir_block.exit_op, ir_block.exit_var[0].value, ir_block.exit_var[1].value) ? ir_block.target : ir_block.next);
+		}
+	}
+	func_ir.RemoveUnreachableBlock();
+}
+
+} // namespace
+
+
+void PropagateConstant(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	ConstantPropagator(func_ir).Run();
+}
\ No newline at end of file
@@ -0,0 +1,9 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Sparse conditional constant propagation over a FuncIR in SSA form. Registers found constant on all executable
+//   paths are replaced with numbers and their definitions removed, and jumps with constant conditions become gotos.
+//   Division by zero and overflowing division are left for runtime.
+void PropagateConstant(FuncIR& func_ir);
\ No newline at end of file
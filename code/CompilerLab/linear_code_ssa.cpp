@@ -0,0 +1,326 @@
+#include "linear_code_ssa.h"
+#include "linear_code_dominator.h"
+
+#include <algorithm>
+#include <tuple>
+
+
+static void RemoveDeadPhi(FuncIR& func_ir) {
+	vector<bool> is_live(func_ir.GetRegCount(), false);
+	vector<uint> phi_block(func_ir.GetRegCount(), -1), phi_index(func_ir.GetRegCount(), -1);
+	vector<uint> work_list;
+	auto MarkLive = [&](const IROperand& src) {
+		if (src.IsReg() && !is_live[src.GetReg()]) { is_live[src.GetReg()] = true; work_list.push_back(src.GetReg()); }
+	};
+	for (uint block = 0; block < func_ir.block_list.size(); ++block) {
+		IRBlock& ir_block = func_ir.block_list[block];
+		uint phi_count = ir_block.GetPhiCount();
+		for (uint index = 0; index < ir_block.instr_list.size(); ++index) {
+			if (index < phi_count) {
+				uint reg = ir_block.instr_list[index].GetDest().GetReg();
+				phi_block[reg] = block; phi_index[reg] = index;
+			} else {
+				ir_block.instr_list[index].ForEachSrc(MarkLive);
+			}
+		}
+		ir_block.ForEachExitSrc(MarkLive);
+	}
+	while (!work_list.empty()) {
+		uint reg = work_list.back(); work_list.pop_back();
+		if (phi_block[reg] != -1) { func_ir.block_list[phi_block[reg]].instr_list[phi_index[reg]].ForEachSrc(MarkLive); }
+	}
+	for (IRBlock& ir_block : func_ir.block_list) {
+		auto phi_end = ir_block.instr_list.begin() + ir_block.GetPhiCount();
+		ir_block.instr_list.erase(std::remove_if(ir_block.instr_list.begin(), phi_end, [&](const IRInstr& phi) {
+			return !is_live[phi.GetDest().GetReg()];
+		}), phi_end);
+	}
+}
+
+void ConstructSSA(FuncIR& func_ir) {
+	assert(!func_ir.is_ssa);
+	func_ir.RemoveUnreachableBlock();
+	DominatorTree dominator_tree(func_ir);
+	vector<IRBlock>& block_list = func_ir.block_list;
+	const uint block_count = (uint)block_list.size(), reg_count = func_ir.GetRegCount();
+
+	// only registers used before defined in some block may need phis
+	vector<bool> is_global(reg_count, false);
+	vector<uint> defined_block(reg_count, -1);
+	vector<vector<uint>> def_block_list(reg_count);
+	for (uint block = 0; block < block_count; ++block) {
+		auto CheckUse = [&](const IROperand& src) {
+			if (src.IsReg() && defined_block[src.GetReg()] != block) { is_global[src.GetReg()] = true; }
+		};
+		for (IRInstr& instr : block_list[block].instr_list) {
+			instr.ForEachSrc(CheckUse);
+			if (instr.HasDest() && instr.GetDest().IsReg() && defined_block[instr.GetDest().GetReg()] != block) {
+				defined_block[instr.GetDest().GetReg()] = block;
+				def_block_list[instr.GetDest().GetReg()].push_back(block);
+			}
+		}
+		block_list[block].ForEachExitSrc(CheckUse);
+	}
+
+	// insert phis
+	vector<vector<uint>> frontier = dominator_tree.GetDominanceFrontier(func_ir);
+	vector<vector<uint>> phi_reg_list(block_count);  // the original register of each phi
+	vector<uint> phi_mark(block_count, -1), work_list_mark(block_count, -1), work_list;
+	for (uint reg = 0; reg < reg_count; ++reg) {
+		if (!is_global[reg]) { continue; }
+		work_list = def_block_list[reg];
+		for (uint block : work_list) { work_list_mark[block] = reg; }
+		while (!work_list.empty()) {
+			uint block = work_list.back(); work_list.pop_back();
+			for (uint frontier_block : frontier[block]) {
+				if (phi_mark[frontier_block] == reg) { continue; }
+				phi_mark[frontier_block] = reg;
+				phi_reg_list[frontier_block].push_back(reg);
+				if (work_list_mark[frontier_block] != reg) { work_list_mark[frontier_block] = reg; work_list.push_back(frontier_block); }
+			}
+		}
+	}
+	for (uint block = 0; block < block_count; ++block) {
+		vector<IRInstr> phi_list;
+		for (uint reg : phi_reg_list[block]) {
+			phi_list.push_back(IRInstr::Phi(IROperand::Reg(reg), vector<IROperand>(block_list[block].predecessor_list.size())));
+		}
+		block_list[block].instr_list.insert(block_list[block].instr_list.begin(), phi_list.begin(), phi_list.end());
+	}
+
+	// rename registers in the preorder of the dominator tree, restoring the current versions when leaving a subtree
+	vector<uint> current_version(reg_count);
+	for (uint reg = 0; reg < reg_count; ++reg) { current_version[reg] = reg; }
+	vector<std::pair<uint, uint>> version_log;  // (register, previous version)
+	auto Define = [&](IROperand& dest) {
+		uint reg = dest.GetReg(), version = func_ir.AllocateReg(func_ir.reg_is_pointer[reg]);
+		version_log.push_back({ reg, current_version[reg] });
+		current_version[reg] = version;
+		dest = IROperand::Reg(version);
+	};
+	auto Use = [&](IROperand& src) { if (src.IsReg()) { src = IROperand::Reg(current_version[src.GetReg()]); } };
+	vector<std::tuple<uint, uint, size_t>> stack{ { 0, 0, 0 } };  // (block, next child, log size when entered)
+	for (bool is_entered = false; !stack.empty();) {
+		auto& [block, child, log_size] = stack.back();
+		if (!is_entered) {
+			IRBlock& ir_block = block_list[block];
+			uint phi_count = (uint)phi_reg_list[block].size();
+			for (uint index = 0; index < ir_block.instr_list.size(); ++index) {
+				IRInstr& instr = ir_block.instr_list[index];
+				if (index >= phi_count) { instr.ForEachSrc(Use); }
+				if (instr.HasDest() && instr.GetDest().IsReg()) { Define(instr.GetDest()); }
+			}
+			ir_block.ForEachExitSrc(Use);
+			for (uint successor : ir_block.GetSuccessorList()) {
+				const vector<uint>& predecessor_list = block_list[successor].predecessor_list;
+				uint k = (uint)(std::find(predecessor_list.begin(), predecessor_list.end(), block) - predecessor_list.begin());
+				for (uint i = 0; i < phi_reg_list[successor].size(); ++i) {
+					block_list[successor].instr_list[i].argument_list[k] = IROperand::Reg(current_version[phi_reg_list[successor][i]]);
+				}
+			}
+		}
+		if (child < dominator_tree.child_list[block].size()) {
+			uint child_block = dominator_tree.child_list[block][child++];
+			stack.push_back({ child_block, 0, version_log.size() });
+			is_entered = false;
+		} else {
+			while (version_log.size() > log_size) { current_version[version_log.back().first] = version_log.back().second; version_log.pop_back(); }
+			stack.pop_back();
+			is_entered = true;
+		}
+	}
+
+	RemoveDeadPhi(func_ir);
+	func_ir.is_ssa = true;
+}
+
+
+namespace {
+
+// Answers if two registers in SSA form interfere, by the liveness at the end of each block.
+class InterferenceChecker {
+private:
+	const DominatorTree& dominator_tree;
+	vector<IRSite> def_site;  // index + 1 of the definition, 0 for a register defined at entry
+	vector<vector<IRSite>> use_site;  // not including phis
+	vector<vector<uint>> live_out;  // sorted
+
+public:
+	InterferenceChecker(const FuncIR& func_ir, const DominatorTree& dominator_tree);
+
+private:
+	bool IsDefBefore(uint reg_a, uint reg_b) const {
+		const IRSite& site_a = def_site[reg_a]; const IRSite& site_b = def_site[reg_b];
+		return site_a.block == site_b.block ? site_a.index <= site_b.index : dominator_tree.Dominates(site_a.block, site_b.block);
+	}
+	bool IsLiveAfterDef(uint reg, uint reg_def) const {
+		const IRSite& site = def_site[reg_def];
+		if (std::binary_search(live_out[site.block].begin(), live_out[site.block].end(), reg)) { return true; }
+		for (const IRSite& use : use_site[reg]) {
+			if (use.block == site.block && use.index > site.index) { return true; }
+		}
+		return false;
+	}
+public:
+	bool Interferes(uint reg_a, uint reg_b) const {
+		if (reg_a == reg_b) { return false; }
+		bool a_before_b = IsDefBefore(reg_a, reg_b), b_before_a = IsDefBefore(reg_b, reg_a);
+		if (a_before_b && b_before_a) { return IsLiveAfterDef(reg_a, reg_b) && IsLiveAfterDef(reg_b, reg_a); }
+		if (a_before_b) { return IsLiveAfterDef(reg_a, reg_b); }
+		if (b_before_a) { return IsLiveAfterDef(reg_b, reg_a); }
+		return false;
+	}
+};
+
+InterferenceChecker::InterferenceChecker(const FuncIR& func_ir, const DominatorTree& dominator_tree) :
+	dominator_tree(dominator_tree), def_site(func_ir.GetRegCount(), IRSite{ 0, 0 }), use_site(func_ir.GetRegCount()) {
+	const vector<IRBlock>& block_list = func_ir.block_list;
+	const uint block_count = (uint)block_list.size();
+	vector<vector<std::pair<uint, uint>>> phi_use(func_ir.GetRegCount());  // (block, predecessor index)
+	for (uint block = 0; block < block_count; ++block) {
+		const IRBlock& ir_block = block_list[block];
+		for (uint index = 0; index < ir_block.instr_list.size(); ++index) {
+			const IRInstr& instr = ir_block.instr_list[index];
+			if (instr.HasDest() && instr.GetDest().IsReg()) { def_site[instr.GetDest().GetReg()] = { block, index + 1 }; }
+			if (instr.type == IRInstrType::Phi) {
+				for (uint k = 0; k < instr.argument_list.size(); ++k) {
+					if (instr.argument_list[k].IsReg()) { phi_use[instr.argument_list[k].GetReg()].push_back({ block, k }); }
+				}
+			} else {
+				instr.ForEachSrc([&](const IROperand& src) { if (src.IsReg()) { use_site[src.GetReg()].push_back({ block, index + 1 }); } });
+			}
+		}
+		uint exit_index = (uint)ir_block.instr_list.size() + 1;
+		ir_block.ForEachExitSrc([&](const IROperand& src) { if (src.IsReg()) { use_site[src.GetReg()].push_back({ block, exit_index }); } });
+	}
+
+	// explore the paths from each use up to the definition
+	live_out.resize(block_count);
+	vector<uint> live_in_mark(block_count, -1), live_out_mark(block_count, -1), work_list;
+	for (uint reg = 0; reg < func_ir.GetRegCount(); ++reg) {
+		uint def_block = def_site[reg].block;
+		auto MarkLiveOut = [&](uint block) {
+			if (live_out_mark[block] == reg) { return; }
+			live_out_mark[block] = reg; live_out[block].push_back(reg);
+			if (block != def_block) { work_list.push_back(block); }
+		};
+		for (const IRSite& use : use_site[reg]) {
+			if (use.block != def_block || use.index <= def_site[reg].index) { work_list.push_back(use.block); }
+		}
+		for (auto [block, k] : phi_use[reg]) { MarkLiveOut(block_list[block].predecessor_list[k]); }
+		while (!work_list.empty()) {
+			uint block = work_list.back(); work_list.pop_back();
+			if (live_in_mark[block] == reg) { continue; }
+			live_in_mark[block] = reg;
+			for (uint predecessor : block_list[block].predecessor_list) { MarkLiveOut(predecessor); }
+		}
+	}
+	for (auto& list : live_out) { std::sort(list.begin(), list.end()); }
+}
+
+} // namespace
+
+
+void DestructSSA(FuncIR& func_ir) {
+	assert(func_ir.is_ssa);
+	func_ir.RemoveUnreachableBlock();
+	RemoveDeadPhi(func_ir);
+	DominatorTree dominator_tree(func_ir);
+	InterferenceChecker interference_checker(func_ir, dominator_tree);
+	vector<IRBlock>& block_list = func_ir.block_list;
+	const uint reg_count = func_ir.GetRegCount();
+
+	// coalesce phis with their arguments, keeping parameters as the representatives of their classes
+	vector<uint> parent(reg_count);
+	for (uint reg = 0; reg < reg_count; ++reg) { parent[reg] = reg; }
+	auto Find = [&](uint reg) {
+		while (parent[reg] != reg) { reg = parent[reg] = parent[parent[reg]]; }
+		return reg;
+	};
+	vector<bool> is_parameter(reg_count, false);
+	for (uint reg : func_ir.parameter_reg) { is_parameter[reg] = true; }
+	vector<uint> phi_block(reg_count, -1);
+	vector<vector<uint>> member_list(reg_count);
+	for (uint reg = 0; reg < reg_count; ++reg) { member_list[reg] = { reg }; }
+	constexpr size_t max_interference_check = 1 << 12;
+	for (uint block = 0; block < block_list.size(); ++block) {
+		for (uint index = 0; index < block_list[block].GetPhiCount(); ++index) {
+			phi_block[block_list[block].instr_list[index].GetDest().GetReg()] = block;
+		}
+	}
+	auto TryCoalesce = [&](uint class_a, uint class_b) {
+		vector<uint>& list_a = member_list[class_a]; vector<uint>& list_b = member_list[class_b];
+		if (list_a.size() * list_b.size() > max_interference_check) { return; }
+		for (uint reg_a : list_a) {
+			for (uint reg_b : list_b) {
+				if (is_parameter[reg_a] && is_parameter[reg_b]) { return; }
+				if (phi_block[reg_a] != -1 && phi_block[reg_a] == phi_block[reg_b]) { return; }
+				if (interference_checker.Interferes(reg_a, reg_b)) { return; }
+			}
+		}
+		bool is_b_parameter = std::any_of(list_b.begin(), list_b.end(), [&](uint reg) { return is_parameter[reg]; });
+		if (is_b_parameter) { std::swap(class_a, class_b); }
+		parent[class_b] = class_a;
+		member_list[class_a].insert(member_list[class_a].end(), member_list[class_b].begin(), member_list[class_b].end());
+		member_list[class_b].clear(); member_list[class_b].shrink_to_fit();
+	};
+	for (uint block = 0; block < block_list.size(); ++block) {
+		for (uint index = 0; index < block_list[block].GetPhiCount(); ++index) {
+			const IRInstr& phi = block_list[block].instr_list[index];
+			for (const IROperand& argument : phi.argument_list) {
+				if (!argument.IsReg()) { continue; }
+				uint class_dest = Find(phi.GetDest().GetReg()), class_argument = Find(argument.GetReg());
+				if (class_dest != class_argument) { TryCoalesce(class_dest, class_argument); }
+			}
+		}
+	}
+	auto Rename = [&](IROperand& operand) { if (operand.IsReg()) { operand = IROperand::Reg(Find(operand.GetReg())); } };
+	for (IRBlock& ir_block : block_list) {
+		for (IRInstr& instr : ir_block.instr_list) {
+			instr.ForEachSrc(Rename);
+			if (instr.HasDest()) { Rename(instr.GetDest()); }
+		}
+		ir_block.ForEachExitSrc(Rename);
+	}
+
+	// replace phis with parallel copies, in a new block on a critical edge
+	for (uint block = 0, block_count = (uint)block_list.size(); block < block_count; ++block) {
+		uint phi_count = block_list[block].GetPhiCount();
+		if (phi_count == 0) { continue; }
+		for (uint k = 0; k < block_list[block].predecessor_list.size(); ++k) {
+			vector<std::pair<uint, IROperand>> copy_list;
+			for (uint index = 0; index < phi_count; ++index) {
+				const IRInstr& phi = block_list[block].instr_list[index];
+				if (phi.argument_list[k] != phi.GetDest()) { copy_list.push_back({ phi.GetDest().GetReg(), phi.argument_list[k] }); }
+			}
+			if (copy_list.empty()) { continue; }
+			uint predecessor = block_list[block].predecessor_list[k];
+			if (block_list[predecessor].exit_type != IRExitType::Goto) {
+				uint new_block = (uint)block_list.size();
+				block_list.emplace_back();
+				block_list[new_block].SetGoto(block);
+				IRBlock& ir_block = block_list[predecessor];
+				if (ir_block.target == block) { ir_block.target = new_block; }
+				if (ir_block.next == block) { ir_block.next = new_block; }
+				predecessor = new_block;
+			}
+			vector<IRInstr>& instr_list = block_list[predecessor].instr_list;
+			while (!copy_list.empty()) {
+				auto it = std::find_if(copy_list.begin(), copy_list.end(), [&](const std::pair<uint, IROperand>& copy) {
+					return std::none_of(copy_list.begin(), copy_list.end(), [&](auto& other) { return other.second.IsReg(copy.first); });
+				});
+				if (it != copy_list.end()) {
+					instr_list.push_back(IRInstr::Copy(IROperand::Reg(it->first), it->second));
+					copy_list.erase(it);
+				} else {  // a cycle
+					uint reg = copy_list.front().first, temp = func_ir.AllocateReg(func_ir.reg_is_pointer[reg]);
+					instr_list.push_back(IRInstr::Copy(IROperand::Reg(temp), IROperand::Reg(reg)));
+					for (auto& copy : copy_list) { if (copy.second.IsReg(reg)) { copy.second = IROperand::Reg(temp); } }
+				}
+			}
+		}
+		block_list[block].instr_list.erase(block_list[block].instr_list.begin(), block_list[block].instr_list.begin() + phi_count);
+	}
+	func_ir.UpdatePredecessor();
+	func_ir.is_ssa = false;
+}
\ No newline at end of file
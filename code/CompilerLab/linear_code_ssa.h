@@ -0,0 +1,13 @@
+#pragma once
+
+#include "linear_code_ir.h"
+
+
+// Renames each definition of a register to a new register, with phis inserted at the iterated dominance frontier
+//   of registers live across blocks. A register used where it's not defined on some path, like a parameter at entry,
+//   keeps its original register there. Also removes unreachable blocks, and phis not used.
+void ConstructSSA(FuncIR& func_ir);
+
+// Coalesces the registers of each phi with its arguments when they don't interfere,
+//   and replaces the phi with copies at the end of the predecessors for the others, splitting critical edges.
+void DestructSSA(FuncIR& func_ir);
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "lexer.h"
 #include "parser.h"
 #include "analyzer.h"
+#include "linear_code_optimizer.h"
 #include "generator.h"
 
 #include "lexer_debug_helper.h"
@@ -8,6 +9,7 @@
 #include "analyzer_debug_helper.h"
 
 #include "linear_code_interpreter.h"
+#include "library_function.h"
 
 #include <iostream>
 #include <fstream>
@@ -23,8 +25,8 @@ const std::string ReadFileToString(const char input_file[]) {
 
 
 int debug_main() {
-	while (true) {
-		string file; std::getline(std::cin, file);
+	// the names of source files are read through the input buffer of the library, which programs read from
+	for (string file; LibraryReadLine(file);) {
 		string input;
 		try {
 			input = ReadFileToString(file.c_str());
@@ -61,6 +63,7 @@ int debug_main() {
 			std::cerr << "semantic error: " << error.what() << std::endl;
 			continue;
 		}
+		LinearCodeOptimizer().Optimize(linear_code);
 		AnalyzerDebugHelper().PrintLinearCode(linear_code);
 
 
@@ -79,6 +82,7 @@ int debug_main() {
 
 
 	}
+	return 0;
 }
 
 
@@ -122,6 +126,7 @@ int main(int argc, const char* argv[]) {
 		std::cerr << "semantic error: " << error.what() << std::endl;
 		return 0;
 	}
+	LinearCodeOptimizer().Optimize(linear_code);
 
 	std::ofstream output(output_file);
 	if (!output) { std::cerr << "invalid output file"; return 0; }
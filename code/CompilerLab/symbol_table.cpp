@@ -1,5 +1,7 @@
 #include "symbol_table.h"
 
+#include <algorithm>
+
 
 uint ArraySize::CalculateArrayLength() {
 	uint length = 1;
@@ -15,7 +17,6 @@ uint ArraySize::CalculateArrayLength() {
 int VarEntry::ReadAtIndex(const ArrayIndex& index) const {
 	assert(IsConst());
 	if (index.size() != dimension.size()) { throw compile_error("expression must have a value type"); }
-	if (index.empty()) { return content[0]; }  // a single variable
 	uint current_size = length; uint current_index = 0;
 	for (uint i = 0; i < index.size(); ++i) {
 		if (index[i] >= dimension[i]) { throw compile_error("can not access position past the end of an array"); }
@@ -24,15 +25,24 @@ int VarEntry::ReadAtIndex(const ArrayIndex& index) const {
 		current_index += current_size * index[i];
 	}
 	assert(current_index < length);
-	return content[current_index];
+	auto it = std::upper_bound(content.begin(), content.end(), current_index, [](uint index, const std::pair<uint, int>& run) { return index < run.first; });
+	assert(it != content.begin());
+	return (it - 1)->second;
 }
 
-vector<int> VarEntry::GetInitialContent(uint length, const InitializingList& initializing_list) {
-	if (length > max_constexpr_array_length) { throw compile_error("array size too large for constexpr evaluation"); }
-	vector<int> content(length);
+// Elements not in the initializing list are zero.
+InitializingList VarEntry::GetInitialContent(uint length, const InitializingList& initializing_list) {
+	InitializingList content;
+	auto AppendRun = [&](uint begin, int value) {
+		if (content.empty() || content.back().second != value) { content.push_back({ begin, value }); }
+	};
+	uint current_index = 0;
 	for (auto& [index, value] : initializing_list) {
-		assert(index < length);
-		content[index] = value;
+		assert(index >= current_index && index < length);
+		if (index > current_index) { AppendRun(current_index, 0); }
+		AppendRun(index, value);
+		current_index = index + 1;
 	}
+	if (current_index < length) { AppendRun(current_index, 0); }
 	return content;
 }
\ No newline at end of file
@@ -47,8 +47,7 @@ public:
 
 	// for const variables
 public:  
-	static constexpr uint max_constexpr_array_length = 65536;
-	const vector<int> content;
+	const InitializingList content;  // runs of equal elements as (begin, value) in order, each extending to the next begin
 	VarEntry(const ArraySize& array_size, const InitializingList& initializing_list) :
 		ArraySize(array_size), index(-1), is_global(false), is_pointer(false),
 		content(GetInitialContent(length, initializing_list)) {
@@ -56,7 +55,7 @@ public:
 	bool IsConst() const { return !content.empty(); }
 	int ReadAtIndex(const ArrayIndex& index) const;
 private:
-	static vector<int> GetInitialContent(uint length, const InitializingList& initializing_list);
+	static InitializingList GetInitialContent(uint length, const InitializingList& initializing_list);
 };
 
 
@@ -0,0 +1,164 @@
+#include "temp_var_packer.h"
+
+#include <algorithm>
+#include <queue>
+
+
+// Each temporary gets a live interval over the positions 2*line (its uses) and 2*line+1 (its definition),
+//   widened over the basic blocks it is live across, and the intervals are packed by a linear scan.
+uint PackTempVar(CodeBlock& code_block, const LabelMap& label_map, uint temp_var_count, uint named_var_length) {
+	const uint line_count = (uint)code_block.size();
+	auto IsTempVar = [&](const CodeLine& line, uint i) {
+		return (line.var_type[i] == CodeLineVarType::Type::Local || line.var_type[i] == CodeLineVarType::Type::Addr) &&
+			(uint)line.var[i] >= temp_var_index_begin;
+	};
+	auto GetTempVar = [&](const CodeLine& line, uint i) { return (uint)line.var[i] - temp_var_index_begin; };
+	auto IsDef = [](const CodeLine& line, uint i) {
+		switch (line.type) {
+		case CodeLineType::BinaryOp: case CodeLineType::UnaryOp: case CodeLineType::Addr: case CodeLineType::Load: return i == 0;
+		case CodeLineType::Store: return i == 0 && line.var_type[0] == CodeLineVarType::Type::Local;
+		case CodeLineType::FuncCall: return i == 1;
+		default: return false;
+		}
+	};
+	auto IsAccessedAtOffset = [](const CodeLine& line, uint i) {  // never for a temporary
+		if (line.var_type[i] != CodeLineVarType::Type::Local) { return false; }
+		if (line.type == CodeLineType::Addr) { return i == 1; }
+		if (line.type == CodeLineType::Fill) { return i == 0; }
+		if (line.type == CodeLineType::MemCopy) { return i == 0 || i == 2; }
+		if ((line.type == CodeLineType::Load && i == 1) || (line.type == CodeLineType::Store && i == 0)) {
+			return !(line.var_type[i + 1] == CodeLineVarType::Type::Number && line.var[i + 1] == 0);
+		}
+		return false;
+	};
+	auto ForEachTempVar = [&](const CodeLine& line, auto use, auto def) {
+		for (uint i = 0; i < 3; ++i) {
+			if (!IsTempVar(line, i)) { continue; }
+			assert(!IsAccessedAtOffset(line, i));
+			if (!IsDef(line, i)) { use(GetTempVar(line, i)); }
+		}
+		for (uint i = 0; i < 3; ++i) {
+			if (IsTempVar(line, i) && IsDef(line, i)) { def(GetTempVar(line, i)); }
+		}
+	};
+	auto GetLabelLine = [&](uint label_index) { return label_map[label_index]; };
+
+	// split basic blocks
+	vector<bool> is_block_begin(line_count + 1, false);
+	is_block_begin[0] = true; is_block_begin[line_count] = true;
+	for (uint line_no = 0; line_no < line_count; ++line_no) {
+		const CodeLine& line = code_block[line_no];
+		if (line.type == CodeLineType::JumpIf || line.type == CodeLineType::Goto) {
+			is_block_begin[GetLabelLine(line.var[0])] = true;
+			is_block_begin[line_no + 1] = true;
+		} else if (line.type == CodeLineType::Return) {
+			is_block_begin[line_no + 1] = true;
+		}
+	}
+	vector<uint> block_begin, line_block(line_count + 1);
+	for (uint line_no = 0; line_no <= line_count; ++line_no) {
+		if (is_block_begin[line_no]) { block_begin.push_back(line_no); }
+		line_block[line_no] = (uint)block_begin.size() - 1;
+	}
+	const uint block_count = (uint)block_begin.size() - 1;  // the last one is the end of the function
+	vector<vector<uint>> block_successor(block_count);
+	for (uint block = 0; block < block_count; ++block) {
+		const CodeLine& line = code_block[block_begin[block + 1] - 1];
+		if (line.type == CodeLineType::JumpIf || line.type == CodeLineType::Goto) {
+			block_successor[block].push_back(line_block[GetLabelLine(line.var[0])]);
+		}
+		if (line.type != CodeLineType::Goto && line.type != CodeLineType::Return) {
+			block_successor[block].push_back(block + 1);
+		}
+	}
+
+	// only temporaries used before defined in some block can be live across blocks
+	vector<uint> global_index(temp_var_count, -1), global_temp_var;
+	vector<uint> defined_block(temp_var_count, -1);
+	for (uint block = 0; block < block_count; ++block) {
+		for (uint line_no = block_begin[block]; line_no < block_begin[block + 1]; ++line_no) {
+			ForEachTempVar(code_block[line_no], [&](uint temp) {
+				if (defined_block[temp] != block && global_index[temp] == -1) {
+					global_index[temp] = (uint)global_temp_var.size(); global_temp_var.push_back(temp);
+				}
+			}, [&](uint temp) { defined_block[temp] = block; });
+		}
+	}
+
+	// solve the liveness of global temporaries, as bit sets of each block
+	const uint word_count = ((uint)global_temp_var.size() + 63) / 64;
+	vector<vector<uint64>> live_in(block_count + 1, vector<uint64>(word_count)), live_out(block_count, vector<uint64>(word_count));
+	vector<vector<uint64>> use_set(block_count, vector<uint64>(word_count)), def_set(block_count, vector<uint64>(word_count));
+	auto SetBit = [](vector<uint64>& set, uint index) { set[index / 64] |= (uint64)1 << (index % 64); };
+	auto GetBit = [](const vector<uint64>& set, uint index) { return (set[index / 64] >> (index % 64) & 1) != 0; };
+	if (word_count > 0) {
+		for (uint block = 0; block < block_count; ++block) {
+			for (uint line_no = block_begin[block]; line_no < block_begin[block + 1]; ++line_no) {
+				ForEachTempVar(code_block[line_no], [&](uint temp) {
+					if (global_index[temp] != -1 && !GetBit(def_set[block], global_index[temp])) { SetBit(use_set[block], global_index[temp]); }
+				}, [&](uint temp) {
+					if (global_index[temp] != -1) { SetBit(def_set[block], global_index[temp]); }
+				});
+			}
+		}
+		for (bool is_changed = true; is_changed;) {
+			is_changed = false;
+			for (uint block = block_count; block-- > 0;) {
+				for (uint word = 0; word < word_count; ++word) {
+					uint64 out = 0;
+					for (uint successor : block_successor[block]) { out |= live_in[successor][word]; }
+					uint64 in = use_set[block][word] | (out & ~def_set[block][word]);
+					if (in != live_in[block][word]) { live_in[block][word] = in; is_changed = true; }
+					live_out[block][word] = out;
+				}
+			}
+		}
+	}
+
+	// get the live interval of each temporary
+	vector<std::pair<uint, uint>> interval(temp_var_count, { -1, 0 });
+	auto Extend = [&](uint temp, uint position) {
+		interval[temp].first = std::min(interval[temp].first, position);
+		interval[temp].second = std::max(interval[temp].second, position);
+	};
+	for (uint line_no = 0; line_no < line_count; ++line_no) {
+		ForEachTempVar(code_block[line_no], [&](uint temp) { Extend(temp, line_no * 2); }, [&](uint temp) { Extend(temp, line_no * 2 + 1); });
+	}
+	for (uint block = 0; block < block_count; ++block) {
+		for (uint index = 0; index < global_temp_var.size(); ++index) {
+			if (GetBit(live_in[block], index)) { Extend(global_temp_var[index], block_begin[block] * 2); }
+			if (GetBit(live_out[block], index)) { Extend(global_temp_var[index], block_begin[block + 1] * 2 - 1); }
+		}
+	}
+
+	// assign slots, the lowest free slot first
+	vector<uint> temp_list;
+	for (uint temp = 0; temp < temp_var_count; ++temp) {
+		if (interval[temp].first != -1) { temp_list.push_back(temp); }
+	}
+	std::sort(temp_list.begin(), temp_list.end(), [&](uint a, uint b) { return interval[a].first < interval[b].first; });
+	vector<uint> temp_slot(temp_var_count, -1); uint slot_count = 0;
+	std::priority_queue<std::pair<uint, uint>, vector<std::pair<uint, uint>>, std::greater<>> active_list;  // (end, slot)
+	std::priority_queue<uint, vector<uint>, std::greater<>> free_slot_list;
+	for (uint temp : temp_list) {
+		while (!active_list.empty() && active_list.top().first < interval[temp].first) {
+			free_slot_list.push(active_list.top().second); active_list.pop();
+		}
+		uint slot;
+		if (free_slot_list.empty()) { slot = slot_count++; } else { slot = free_slot_list.top(); free_slot_list.pop(); }
+		temp_slot[temp] = slot;
+		active_list.push({ interval[temp].second, slot });
+	}
+
+	// rewrite the code with packed slots
+	CodeBlock packed_code_block; packed_code_block.reserve(line_count);
+	for (const CodeLine& line : code_block) {
+		int var[3] = { line.var[0], line.var[1], line.var[2] };
+		for (uint i = 0; i < 3; ++i) {
+			if (IsTempVar(line, i)) { var[i] = (int)(named_var_length + temp_slot[GetTempVar(line, i)]); }
+		}
+		packed_code_block.push_back(CodeLine::ReplaceVar(line, var[0], var[1], var[2]));
+	}
+	code_block = std::move(packed_code_block);
+	return named_var_length + slot_count;
+}
\ No newline at end of file
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "linear_code.h"
+
+
+// Temporaries are numbered from temp_var_index_begin in a CodeBlock, apart from named variables,
+//   and are packed into shared slots after the named variables, as temporaries with disjoint lifetimes can use the same slot.
+constexpr uint temp_var_index_begin = 1u << 30;
+
+// Returns the local variable length with the packed slots.
+uint PackTempVar(CodeBlock& code_block, const LabelMap& label_map, uint temp_var_count, uint named_var_length);
\ No newline at end of file
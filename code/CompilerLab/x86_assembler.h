@@ -0,0 +1,135 @@
+#pragma once
+
+#include "core.h"
+
+#include <vector>
+
+
+using std::vector;
+
+
+// A minimal x86-64 assembler for the instructions used by LinearCodeJit.
+//   32-bit operations are used unless is_64 is set, memory operands are [base + index * (1 << scale) + disp].
+
+enum class X86Reg : uchar { rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15 };
+
+enum class X86Cond : uchar { O, NO, B, AE, E, NE, BE, A, S, NS, P, NP, L, GE, LE, G };
+
+enum class X86AluOp : uchar { Add, Or, Adc, Sbb, And, Sub, Xor, Cmp };
+
+
+struct X86Mem {
+public:
+	const X86Reg base;
+	const X86Reg index;
+	const bool has_index;
+	const uchar scale;
+	const int disp;
+public:
+	X86Mem(X86Reg base, int disp = 0) : base(base), index(X86Reg::rax), has_index(false), scale(0), disp(disp) {}
+	X86Mem(X86Reg base, X86Reg index, uchar scale, int disp = 0) : base(base), index(index), has_index(true), scale(scale), disp(disp) {
+		assert(index != X86Reg::rsp && scale < 4);
+	}
+};
+
+
+class X86Assembler {
+public:
+	using Label = uint;
+
+private:
+	vector<uchar> code;
+	vector<int> label_offset;  // -1 if not bound yet
+	vector<std::pair<uint, Label>> fixup_list;  // (offset of rel32, label)
+
+public:
+	uint GetSize() const { return (uint)code.size(); }
+	const vector<uchar>& GetCode() const { assert(fixup_list.empty()); return code; }
+
+public:
+	Label NewLabel() { label_offset.push_back(-1); return (Label)label_offset.size() - 1; }
+	void Bind(Label label) { assert(label_offset[label] == -1); label_offset[label] = (int)code.size(); }
+	uint GetLabelOffset(Label label) const { assert(label_offset[label] != -1); return (uint)label_offset[label]; }
+	void ResolveLabels() {
+		for (auto [offset, label] : fixup_list) {
+			assert(label_offset[label] != -1);
+			int rel = label_offset[label] - (int)(offset + 4);
+			for (uint i = 0; i < 4; ++i) { code[offset + i] = (uchar)((uint)rel >> (i * 8)); }
+		}
+		fixup_list.clear();
+	}
+
+private:
+	static uint Low(X86Reg reg) { return (uint)reg & 7; }
+	static uint High(X86Reg reg) { return (uint)reg >> 3; }
+	static bool IsInt8(int value) { return value >= -128 && value <= 127; }
+
+private:
+	void Emit(uchar byte) { code.push_back(byte); }
+	void Emit32(int value) { for (uint i = 0; i < 4; ++i) { Emit((uchar)((uint)value >> (i * 8))); } }
+	void EmitRel32(Label label) { fixup_list.push_back({ (uint)code.size(), label }); Emit32(0); }
+	void EmitRex(bool is_64, uint reg_high, uint index_high, uint base_high) {
+		uchar rex = (uchar)(0x40 | (is_64 << 3) | (reg_high << 2) | (index_high << 1) | base_high);
+		if (rex != 0x40) { Emit(rex); }
+	}
+	void EmitModRM(uint reg_low, const X86Mem& mem) {
+		bool has_sib = mem.has_index || Low(mem.base) == 4;
+		uint mod = mem.disp == 0 && Low(mem.base) != 5 ? 0 : IsInt8(mem.disp) ? 1 : 2;
+		Emit((uchar)((mod << 6) | (reg_low << 3) | (has_sib ? 4 : Low(mem.base))));
+		if (has_sib) { Emit((uchar)((mem.scale << 6) | ((mem.has_index ? Low(mem.index) : 4) << 3) | Low(mem.base))); }
+		if (mod == 1) { Emit((uchar)mem.disp); }
+		if (mod == 2) { Emit32(mem.disp); }
+	}
+	// [rex] opcode modrm, with reg as the reg field
+	void EmitOp(std::initializer_list<uchar> opcode, bool is_64, uint reg, const X86Mem& mem) {
+		EmitRex(is_64, reg >> 3, mem.has_index ? High(mem.index) : 0, High(mem.base));
+		for (uchar byte : opcode) { Emit(byte); }
+		EmitModRM(reg & 7, mem);
+	}
+	void EmitOp(std::initializer_list<uchar> opcode, bool is_64, uint reg, X86Reg rm) {
+		EmitRex(is_64, reg >> 3, 0, High(rm));
+		for (uchar byte : opcode) { Emit(byte); }
+		Emit((uchar)(0xC0 | ((reg & 7) << 3) | Low(rm)));
+	}
+
+public:
+	void MovRegImm(X86Reg reg, int imm) { EmitRex(false, 0, 0, High(reg)); Emit((uchar)(0xB8 + Low(reg))); Emit32(imm); }
+	void MovRegImm64(X86Reg reg, uint64 imm) { EmitRex(true, 0, 0, High(reg)); Emit((uchar)(0xB8 + Low(reg))); Emit32((int)imm); Emit32((int)(imm >> 32)); }
+	void MovRegReg(X86Reg dest, X86Reg src, bool is_64 = false) { EmitOp({ 0x89 }, is_64, (uint)src, dest); }
+	void MovRegMem(X86Reg reg, const X86Mem& mem, bool is_64 = false) { EmitOp({ 0x8B }, is_64, (uint)reg, mem); }
+	void MovMemReg(const X86Mem& mem, X86Reg reg, bool is_64 = false) { EmitOp({ 0x89 }, is_64, (uint)reg, mem); }
+	void MovMemImm(const X86Mem& mem, int imm) { EmitOp({ 0xC7 }, false, 0, mem); Emit32(imm); }
+	void Lea(X86Reg reg, const X86Mem& mem, bool is_64 = true) { EmitOp({ 0x8D }, is_64, (uint)reg, mem); }
+
+	void AluRegReg(X86AluOp op, X86Reg dest, X86Reg src, bool is_64 = false) { EmitOp({ (uchar)(((uint)op << 3) | 1) }, is_64, (uint)src, dest); }
+	void AluRegMem(X86AluOp op, X86Reg reg, const X86Mem& mem, bool is_64 = false) { EmitOp({ (uchar)(((uint)op << 3) | 3) }, is_64, (uint)reg, mem); }
+	void AluRegImm(X86AluOp op, X86Reg reg, int imm, bool is_64 = false) {
+		if (IsInt8(imm)) { EmitOp({ 0x83 }, is_64, (uint)op, reg); Emit((uchar)imm); } else { EmitOp({ 0x81 }, is_64, (uint)op, reg); Emit32(imm); }
+	}
+	void ImulRegMem(X86Reg reg, const X86Mem& mem) { EmitOp({ 0x0F, 0xAF }, false, (uint)reg, mem); }
+	void ImulRegRegImm(X86Reg dest, X86Reg src, int imm) { EmitOp({ 0x69 }, false, (uint)dest, src); Emit32(imm); }
+	void Cdq() { Emit(0x99); }
+	void Idiv(X86Reg reg) { EmitOp({ 0xF7 }, false, 7, reg); }
+	void Neg(X86Reg reg) { EmitOp({ 0xF7 }, false, 3, reg); }
+	void Test(X86Reg reg1, X86Reg reg2) { EmitOp({ 0x85 }, false, (uint)reg2, reg1); }
+	// reg = cond ? 1 : 0, for rax, rcx, rdx and rbx only
+	void SetccZeroExtend(X86Cond cond, X86Reg reg) {
+		assert((uint)reg < 4);
+		Emit(0x0F); Emit((uchar)(0x90 + (uint)cond)); Emit((uchar)(0xC0 + Low(reg)));
+		Emit(0x0F); Emit(0xB6); Emit((uchar)(0xC0 | (Low(reg) << 3) | Low(reg)));
+	}
+
+	void Jcc(X86Cond cond, Label label) { Emit(0x0F); Emit((uchar)(0x80 + (uint)cond)); EmitRel32(label); }
+	void Jmp(Label label) { Emit(0xE9); EmitRel32(label); }
+	void JmpReg(X86Reg reg) { EmitOp({ 0xFF }, false, 4, reg); }
+	void CallReg(X86Reg reg) { EmitOp({ 0xFF }, false, 2, reg); }
+	void CallMem(const X86Mem& mem) { EmitOp({ 0xFF }, false, 2, mem); }
+	void Push(X86Reg reg) { EmitRex(false, 0, 0, High(reg)); Emit((uchar)(0x50 + Low(reg))); }
+	void Pop(X86Reg reg) { EmitRex(false, 0, 0, High(reg)); Emit((uchar)(0x58 + Low(reg))); }
+	void Ret() { Emit(0xC3); }
+	void RepStosd() { Emit(0xF3); Emit(0xAB); }
+	void RepMovsd() { Emit(0xF3); Emit(0xA5); }
+
+public:
+	static X86Cond Negate(X86Cond cond) { return (X86Cond)((uint)cond ^ 1); }
+};
\ No newline at end of file